@@ -0,0 +1,362 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "database.h"
+
+using namespace sql;
+
+/**
+ * bench
+ *
+ * Micro and macro benchmarks over the wrapper's hot paths, run once against a
+ * plain and once against an encrypted database. Every operation is timed on
+ * its own; results are written as JSON:
+ *
+ *     bench [output.json] [rows]
+ *
+ * Data and lookup keys are generated from fixed seeds and the database files
+ * are recreated on every run, so two runs of one build do the same work.
+ */
+
+static std::atomic<uint64_t> g_allocBytes(0);
+static std::atomic<uint64_t> g_allocCount(0);
+
+#if defined(__GLIBC__)
+/*count every malloc, sqlite and operator new included*/
+#define BENCH_COUNT_ALLOCATIONS 1
+
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void  __libc_free(void* ptr);
+
+    void* malloc(size_t size) __THROW
+    {
+        g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+        g_allocCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) __THROW
+    {
+        g_allocBytes.fetch_add(count * size, std::memory_order_relaxed);
+        g_allocCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size) __THROW
+    {
+        g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+        g_allocCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr) __THROW
+    {
+        __libc_free(ptr);
+    }
+}
+#endif
+
+typedef std::chrono::steady_clock BenchClock;
+
+struct BenchResult
+{
+    std::string name;
+    bool     encrypted;
+    int      ops;
+    int      rowsPerOp;
+    double   seconds;
+    int64_t  p50Ns;
+    int64_t  p99Ns;
+    uint64_t bytes;
+    uint64_t allocs;
+};
+
+/*deterministic key stream for lookups, same sequence on every run*/
+class BenchRandom
+{
+public:
+    BenchRandom(uint64_t seed)
+        : m_state(seed)
+    {
+    }
+
+    int64_t next(int64_t bound)
+    {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<int64_t>((m_state >> 33) % static_cast<uint64_t>(bound));
+    }
+
+private:
+    uint64_t m_state;
+};
+
+template<typename Op>
+static BenchResult measure(const char* name, bool encrypted, int ops, int rowsPerOp, Op op)
+{
+    std::vector<int64_t> samples;
+    samples.reserve(ops);
+
+    uint64_t bytes = g_allocBytes.load();
+    uint64_t allocs = g_allocCount.load();
+    BenchClock::time_point begin = BenchClock::now();
+    for (int i = 0; i < ops; i++) {
+        BenchClock::time_point start = BenchClock::now();
+        op(i);
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    BenchClock::now() - start).count());
+    }
+    BenchClock::time_point end = BenchClock::now();
+
+    BenchResult result;
+    result.allocs = g_allocCount.load() - allocs;
+    result.bytes = g_allocBytes.load() - bytes;
+
+    result.name = name;
+    result.encrypted = encrypted;
+    result.ops = ops;
+    result.rowsPerOp = rowsPerOp;
+    result.seconds = std::chrono::duration<double>(end - begin).count();
+
+    std::sort(samples.begin(), samples.end());
+    result.p50Ns = samples.empty() ? 0 : samples[(samples.size() - 1) * 50 / 100];
+    result.p99Ns = samples.empty() ? 0 : samples[(samples.size() - 1) * 99 / 100];
+
+    std::cerr << (encrypted ? "encrypted " : "plain     ") << name
+              << ": " << static_cast<int64_t>(ops / result.seconds) << " ops/s\n";
+
+    return result;
+}
+
+static void formatRow(int64_t id, char* name, size_t nameSize, char* code, size_t codeSize)
+{
+    snprintf(name, nameSize, "name-%08lld", static_cast<long long>(id));
+    snprintf(code, codeSize, "C%03d", static_cast<int>(id % 1000));
+}
+
+static void fillRow(DBDataRow& row, int64_t id)
+{
+    char name[32];
+    char code[8];
+    formatRow(id, name, sizeof(name), code, sizeof(code));
+
+    row.putLong(0, id, "ID");
+    row.putString(1, name, sizeof(name), "NAME");
+    row.putLong(2, 20 + id % 50, "AGE");
+    row.putDouble(3, 1000.0 + id, "SALARY");
+    row.putString(4, code, sizeof(code), "CODE");
+}
+
+static void fillRow(DBDataTable& table, int row, int64_t id)
+{
+    char name[32];
+    char code[8];
+    formatRow(id, name, sizeof(name), code, sizeof(code));
+
+    table.putLong(row, 0, id);
+    table.putString(row, 1, name, sizeof(name));
+    table.putLong(row, 2, 20 + id % 50);
+    table.putDouble(row, 3, 1000.0 + id);
+    table.putString(row, 4, code, sizeof(code));
+}
+
+static void removeDatabase(const std::string& path)
+{
+    remove(path.c_str());
+    remove((path + "-journal").c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+}
+
+static bool runSuite(bool encrypted, int rows, std::vector<BenchResult>& results)
+{
+    static const char key[] = "bench-key";
+    const int singleOps = 500;
+    const int batchRows = 1000;
+    const int lookupOps = 5000;
+    const int scanOps = 20;
+    const int writeOps = 500;
+
+    std::string path = encrypted ? "bench_encrypted.db" : "bench_plain.db";
+    removeDatabase(path);
+
+    database db(path, encrypted ? key : NULL, encrypted ? sizeof(key) - 1 : 0);
+    if (!db.isOpen()) {
+        std::cerr << "open " << path << " failed\n";
+        return false;
+    }
+
+    int err = db.exec("CREATE TABLE BENCH("
+            "ID INTEGER PRIMARY KEY,"
+            "NAME TEXT,"
+            "AGE INTEGER,"
+            "SALARY REAL,"
+            "CODE TEXT);");
+    if (err != DB_OK) {
+        std::cerr << "create table failed: " << err << "\n";
+        return false;
+    }
+
+    // single-row inserts, one implicit transaction each.
+    results.push_back(measure("insert_single", encrypted, singleOps, 1, [&](int i) {
+        DBDataRow row(5);
+        fillRow(row, i);
+        db.insert("BENCH", row);
+    }));
+
+    // batches of batchRows rows through insertMany, tables built before timing.
+    std::vector<DBDataTable> batches;
+    int batchCount = (rows + batchRows - 1) / batchRows;
+    for (int b = 0; b < batchCount; b++) {
+        DBDataTable table(5);
+        table.setColumnName(0, "ID");
+        table.setColumnName(1, "NAME");
+        table.setColumnName(2, "AGE");
+        table.setColumnName(3, "SALARY");
+        table.setColumnName(4, "CODE");
+        for (int r = 0; r < batchRows; r++) {
+            table.addRow();
+            fillRow(table, r, singleOps + b * batchRows + r);
+        }
+        batches.push_back(std::move(table));
+    }
+
+    results.push_back(measure("insert_batched", encrypted, batchCount, batchRows, [&](int i) {
+        db.insertMany("BENCH", batches[i]);
+    }));
+
+    int64_t total = singleOps + static_cast<int64_t>(batchCount) * batchRows;
+
+    BenchRandom random(42);
+    results.push_back(measure("point_lookup", encrypted, lookupOps, 1, [&](int) {
+        std::unique_ptr<DBDataTable> t = db.rawQuery("SELECT * FROM BENCH WHERE ID=?", random.next(total));
+    }));
+
+    results.push_back(measure("scan", encrypted, scanOps, total, [&](int) {
+        std::unique_ptr<DBDataTable> t = db.rawQuery("SELECT * FROM BENCH");
+    }));
+
+    DBDataTable reused(0);
+    results.push_back(measure("table_fill", encrypted, scanOps, total, [&](int) {
+        db.rawQuery(reused, "SELECT * FROM BENCH");
+    }));
+
+    volatile int64_t sink = 0;
+    results.push_back(measure("table_read", encrypted, scanOps, total, [&](int) {
+        int64_t sum = 0;
+        int rowCount = reused.getRowCount();
+        int columnCount = reused.getColumnCount();
+        for (int r = 0; r < rowCount; r++) {
+            for (int c = 0; c < columnCount; c++) {
+                size_t length = 0;
+                switch (reused.getType(r, c)) {
+                case DBDataType_Integer:
+                    sum += reused.getLong(r, c);
+                    break;
+                case DBDataType_Float:
+                    sum += static_cast<int64_t>(reused.getDouble(r, c));
+                    break;
+                case DBDataType_String:
+                    reused.getString(r, c, length);
+                    sum += length;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+        sink = sink + sum;
+    }));
+
+    BenchRandom updateKeys(7);
+    results.push_back(measure("update", encrypted, writeOps, 1, [&](int i) {
+        DBDataRow row(1);
+        row.putLong(0, i, "AGE");
+        std::vector<std::string> args;
+        std::ostringstream id;
+        id << updateKeys.next(total);
+        args.push_back(id.str());
+        db.update("BENCH", row, "ID=?", args);
+    }));
+
+    results.push_back(measure("remove", encrypted, writeOps, 1, [&](int i) {
+        std::vector<std::string> args;
+        std::ostringstream id;
+        id << i;
+        args.push_back(id.str());
+        db.remove("BENCH", "ID=?", args);
+    }));
+
+    db.close();
+    removeDatabase(path);
+
+    return true;
+}
+
+static void writeJson(std::ostream& out, const std::vector<BenchResult>& results)
+{
+    out << "{\n  \"allocations_counted\": ";
+#if defined(BENCH_COUNT_ALLOCATIONS)
+    out << "true";
+#else
+    out << "false";
+#endif
+    out << ",\n  \"benchmarks\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        double ops = r.seconds > 0 ? r.ops / r.seconds : 0;
+
+        out << "    {"
+            << "\"name\": \"" << r.name << "\", "
+            << "\"encrypted\": " << (r.encrypted ? "true" : "false") << ", "
+            << "\"ops\": " << r.ops << ", "
+            << "\"rows_per_op\": " << r.rowsPerOp << ", "
+            << "\"ops_per_sec\": " << static_cast<int64_t>(ops) << ", "
+            << "\"rows_per_sec\": " << static_cast<int64_t>(ops * r.rowsPerOp) << ", "
+            << "\"p50_ns\": " << r.p50Ns << ", "
+            << "\"p99_ns\": " << r.p99Ns << ", "
+            << "\"bytes_allocated\": " << r.bytes << ", "
+            << "\"allocations\": " << r.allocs << ", "
+            << "\"bytes_per_op\": " << (r.ops > 0 ? r.bytes / r.ops : 0)
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string output = argc > 1 ? argv[1] : "bench.json";
+    int rows = argc > 2 ? atoi(argv[2]) : 20000;
+    if (rows <= 0) {
+        std::cerr << "usage: bench [output.json] [rows]\n";
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    if (!runSuite(false, rows, results) || !runSuite(true, rows, results)) {
+        return 1;
+    }
+
+    std::ofstream out(output.c_str());
+    if (!out) {
+        std::cerr << "cannot write " << output << "\n";
+        return 1;
+    }
+    writeJson(out, results);
+
+    return 0;
+}
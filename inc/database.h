@@ -1,11 +1,25 @@
 #ifndef __DATABASE_H__
 #define __DATABASE_H__
 
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <memory>
+#include <random>
 
 #include "database_data.h"
+#include "database_column.h"
+#include "database_bind.h"
+#include "database_cursor.h"
+#include "database_mapping.h"
+#include "database_transaction.h"
+#include "database_statement.h"
+#include "database_stats.h"
+#include "database_cache.h"
+#include "database_change.h"
+#include "database_backup.h"
 
 struct sqlite3;
 struct sqlite3_stmt;
@@ -14,47 +28,138 @@ namespace sql {
 
 enum {
     DB_OK = 0,
-    DB_ERROR
+    DB_ERROR = 1,
+    /*gave up on a database locked by another connection, same value as SQLITE_BUSY*/
+    DB_BUSY = 5,
+    /*stopped by cancel(), same value as SQLITE_INTERRUPT*/
+    DB_CANCELLED = 9,
+    /*stopped by the query timeout, no sqlite counterpart*/
+    DB_TIMEOUT = 256,
+    /*the queue of AsyncDatabase was full or stopped*/
+    DB_REJECTED = 257
+};
+
+/*restarts of statements that failed with BUSY or LOCKED, maxRetries 0 disables*/
+struct DBRetryPolicy
+{
+    int maxRetries;
+    /*delay before restart n is baseDelayMs * 2^n, capped at maxDelayMs, with jitter*/
+    int baseDelayMs;
+    int maxDelayMs;
+};
+
+struct DBBusyStats
+{
+    uint64_t busy;      /*steps and commits that failed with BUSY or LOCKED*/
+    uint64_t waits;     /*sleeps of the busy handler*/
+    uint64_t retries;   /*statements restarted by the retry policy*/
+    uint64_t failures;  /*calls that gave up with DB_BUSY*/
+    uint64_t waitNs;    /*time slept in the busy handler and between retries*/
 };
 
 class database 
 {
     public:
-        database(const std::string& path, const void* pKey = NULL, int nKey = 0);
+        database(const std::string& path, const void* pKey = NULL, int nKey = 0, bool readOnly = false);
         virtual ~database();
 
         int exec(const std::string& sql);
 
 
-        /*Cursor* should replace to shared pointer!*/
+        /*results are owned by the caller, NULL on error or an empty result*/
+        std::unique_ptr<DBDataTable> rawQuery(const std::string& sql, const std::vector<std::string>& args);
 
-        DBDataTable* rawQuery(const std::string& sql, const std::vector<std::string>& args);
+        /*each argument is bound natively, see DBBinder*/
+        template<typename... Args>
+        std::unique_ptr<DBDataTable> rawQuery(const std::string& sql, const Args&... args);
 
-        DBDataTable* query(const std::string& table, const std::vector<std::string>& columns,
+        std::unique_ptr<DBDataTable> query(const std::string& table, const std::vector<std::string>& columns,
                         const std::string& where, const std::vector<std::string>& whereArgs,
                         const std::string& orderBy);
 
-        DBDataTable* query(const std::string& table, const std::vector<std::string>& columns,
+        std::unique_ptr<DBDataTable> query(const std::string& table, const std::vector<std::string>& columns,
                        const std::string& where, const std::vector<std::string>& whereArgs,
                        const std::string& groupBy,const std::string& having, const std::string& orderBy);
 
-        DBDataTable* query(const std::string& table, const std::vector<std::string>& columns,
+        std::unique_ptr<DBDataTable> query(const std::string& table, const std::vector<std::string>& columns,
                        const std::string& where, const std::vector<std::string>& whereArgs,
                        const std::string& groupBy,
                        const std::string& having, const std::string& orderBy, const std::string& limit);
 
-        DBDataTable* query(bool distinct, const std::string& table, const std::vector<std::string>& columns,
+        std::unique_ptr<DBDataTable> query(bool distinct, const std::string& table, const std::vector<std::string>& columns,
                        const std::string& where, const std::vector<std::string>& whereArgs,
                        const std::string& groupBy,
                        const std::string& having, const std::string& orderBy, const std::string& limit);
 
-        int insert(const std::string& table, const DBDataRow& values);
+        /*served from the result cache when it is enabled, see setResultCacheSize;
+          the table is shared and must not be changed, NULL on error or an empty result*/
+        std::shared_ptr<const DBDataTable> rawQueryCached(const std::string& sql, const std::vector<std::string>& args);
+
+        std::shared_ptr<const DBDataTable> queryCached(const std::string& table, const std::vector<std::string>& columns,
+                        const std::string& where, const std::vector<std::string>& whereArgs,
+                        const std::string& orderBy);
+
+        /*fills a caller owned table, reusing its payload memory, returns the row count*/
+        int rawQuery(DBDataTable& result, const std::string& sql, const std::vector<std::string>& args);
+
+        template<typename... Args>
+        int rawQuery(DBDataTable& result, const std::string& sql, const Args&... args);
+
+        /*result stored column by column, see DBColumnTable*/
+        std::unique_ptr<DBColumnTable> rawQueryColumns(const std::string& sql, const std::vector<std::string>& args);
+
+        template<typename... Args>
+        std::unique_ptr<DBColumnTable> rawQueryColumns(const std::string& sql, const Args&... args);
+
+        /*rows are stepped on demand, release the cursor before closing the database*/
+        std::unique_ptr<Cursor> rawQueryCursor(const std::string& sql, const std::vector<std::string>& args);
+
+        template<typename... Args>
+        std::unique_ptr<Cursor> rawQueryCursor(const std::string& sql, const Args&... args);
+
+        /*rows decoded into T through DBMapping<T>, returns the number of rows or -1*/
+        template<typename T, typename... Args>
+        int rawQueryAs(std::vector<T>& result, const std::string& sql, const Args&... args);
+
+        /*callback(const T&) is called once per row*/
+        template<typename T, typename Callback, typename... Args>
+        int rawQueryEach(const std::string& sql, Callback callback, const Args&... args);
+
+        std::unique_ptr<Cursor> queryCursor(const std::string& table, const std::vector<std::string>& columns,
+                        const std::string& where, const std::vector<std::string>& whereArgs,
+                        const std::string& orderBy);
+
+        std::unique_ptr<Cursor> queryCursor(bool distinct, const std::string& table, const std::vector<std::string>& columns,
+                       const std::string& where, const std::vector<std::string>& whereArgs,
+                       const std::string& groupBy,
+                       const std::string& having, const std::string& orderBy, const std::string& limit);
+
+        /*rowid of the new row, -1 on failure*/
+        int64_t insert(const std::string& table, const DBDataRow& values);
+
+        /*insert every row with one statement, committing every batch size rows,
+          -1 when a commit failed and the open batch was rolled back*/
+        int insertMany(const std::string& table, const DBDataTable& values,
+                       std::vector<int>* failedRows = NULL);
+
+        template<typename Iterator>
+        int insertMany(const std::string& table, Iterator first, Iterator last,
+                       std::vector<int>* failedRows = NULL);
+
+        void setBatchSize(int rows);
 
         int update(const std::string& table, const DBDataRow& values,
                    const std::string& where, const std::vector<std::string>& whereArgs);
 
         int remove(const std::string& table, const std::string& where, const std::vector<std::string>& whereArgs);
 
+        template<typename... Args>
+        int update(const std::string& table, const DBDataRow& values,
+                   const std::string& where, const Args&... whereArgs);
+
+        template<typename... Args>
+        int remove(const std::string& table, const std::string& where, const Args&... whereArgs);
+
         void close();
         bool isOpen();
         bool isReadOnly();
@@ -62,17 +167,379 @@ class database
         void setVersion(int version);
         std::string getPath();
 
+        /*results of rawQueryCached/queryCached kept up to budgetBytes, 0 disables the
+          cache; with watchOtherConnections every lookup first checks PRAGMA data_version
+          so commits of other connections are seen, otherwise only writes of this one*/
+        void setResultCacheSize(size_t budgetBytes, bool watchOtherConnections = true);
+        DBResultCacheStats getResultCacheStats() const;
+        void clearResultCache();
+
+        /*row changes are pushed to the feed once the COMMIT (or the autocommit statement)
+          succeeded, changes of rolled back transactions, savepoints and failed statements,
+          exec() ones included, are left out; no hooks are installed while nobody is subscribed*/
+        std::shared_ptr<DBChangeFeed> subscribeChanges(size_t capacity = 4096,
+                                                       const DBChangeFeed::Notify& notify = DBChangeFeed::Notify());
+        void unsubscribeChanges(const std::shared_ptr<DBChangeFeed>& feed);
+        /*old and new column values with every change, false when sqlite was built
+          without SQLITE_ENABLE_PREUPDATE_HOOK*/
+        bool setChangeValues(bool capture);
+
+        /*online copy of the database on a background thread, NULL when it cannot
+          start; the destination file is encrypted with pKey, which may differ from
+          the source key, but an encrypted database cannot be copied into a plain
+          one or the other way round (DB_ERROR). This connection stays usable
+          meanwhile, but must not be closed before the backup ended*/
+        std::unique_ptr<DBBackup> backupTo(const std::string& path, int pagesPerStep = 64, int sleepMs = 10,
+                                           const void* pKey = NULL, int nKey = 0,
+                                           const DBBackup::ProgressHandler& handler = DBBackup::ProgressHandler());
+        /*into another open connection, a ":memory:" one takes a snapshot; dest
+          must not be used until the backup ended*/
+        std::unique_ptr<DBBackup> backupTo(database& dest, int pagesPerStep = 64, int sleepMs = 10,
+                                           const DBBackup::ProgressHandler& handler = DBBackup::ProgressHandler());
+
+        /*prepared statements kept per connection, 0 disables the cache*/
+        void setStatementCacheSize(size_t capacity);
+        DBStatementCacheStats getStatementCacheStats() const;
+
+        /*per statement timings, off by default and free while off*/
+        void setStatsEnabled(bool enabled);
+        bool isStatsEnabled() const;
+        /*since enabled or resetStats(), most expensive first*/
+        std::vector<DBStatementStats> stats() const;
+        /*since the previous call, each call starts a new interval*/
+        std::vector<DBStatementStats> intervalStats();
+        void resetStats();
+
+        /*statements run by rawQuery/query/insert/update/remove slower than thresholdMs
+          are reported with their query plan, -1 disables*/
+        void setSlowQueryThreshold(int thresholdMs);
+        /*report SQL with values replaced by '?'*/
+        void setSlowQueryRedaction(bool redact);
+        void setSlowQueryHandler(const DBSlowQueryHandler& handler);
+
+        /*DB_OK, DB_ERROR, DB_BUSY, DB_TIMEOUT or DB_CANCELLED for the last call
+          that ran a statement*/
+        int lastError() const;
+
+        /*wait up to timeoutMs for locks of other connections, sleeping with
+          backoff between attempts, 0 fails at once with DB_BUSY*/
+        void setBusyTimeout(int timeoutMs);
+        /*only statements outside a transaction are restarted, inside one the
+          caller has to roll back first*/
+        void setRetryPolicy(const DBRetryPolicy& policy);
+        /*single statement writes and insertMany take the write lock up front
+          with BEGIN IMMEDIATE, so they cannot deadlock against another writer*/
+        void setImmediateWrites(bool immediate);
+        DBBusyStats getBusyStats() const;
+        void resetBusyStats();
+
+        /*each call is stopped with DB_TIMEOUT after timeoutMs, 0 disables; an
+          interrupted write inside a transaction rolls the transaction back*/
+        void setQueryTimeout(int timeoutMs);
+        /*stops the call running on another thread with DB_CANCELLED, also stops
+          open cursors; must not race close()*/
+        void cancel();
 
     private:
+        friend class Transaction;
+        friend class Cursor;
+
         database(const database&);
         database& operator= (const database&);
 
         std::string m_path;
         sqlite3*    m_dbHandle;
+        DBStatementCache* m_statements;
+        DBQueryStats* m_queryStats;
+        DBSlowQueryLog m_slowQueries;
+        DBResultCache* m_resultCache;
+        bool        m_watchOtherConnections;
+        int64_t     m_dataVersion;
+        DBChangeLog* m_changes;
+        bool        m_changeValues;
+        int         m_batchSize;
+        int         m_transactionDepth;
+        int         m_lastError;
+
+        int           m_busyTimeoutMs;
+        DBRetryPolicy m_retryPolicy;
+        bool          m_immediateWrites;
+        DBBusyStats   m_busyStats;
+        std::chrono::steady_clock::time_point m_busyStart;
+        std::minstd_rand m_random;
+
+        int         m_queryTimeoutMs;
+        /*zero while no deadline is set*/
+        std::chrono::steady_clock::time_point m_deadline;
+        bool        m_timedOut;
+        std::atomic<bool> m_cancelled;
 
         int fillTable(sqlite3_stmt* stmt, DBDataTable* dataTable);
+        int fillTable(sqlite3_stmt* stmt, DBColumnTable* columnTable);
+
+        static std::string querySql(bool distinct, const std::string& table,
+                                    const std::vector<std::string>& columns, const std::string& where,
+                                    const std::string& groupBy, const std::string& having,
+                                    const std::string& orderBy, const std::string& limit);
+        static std::string insertSql(const std::string& table, const DBDataSchema& schema);
+        static std::string updateSql(const std::string& table, const DBDataRow& values, const std::string& where);
+        static std::string removeSql(const std::string& table, const std::string& where);
+        int bindRow(sqlite3_stmt* stmt, const DBDataRow& values, int offset);
+
+        std::unique_ptr<DBDataTable> fetchTable(const std::string& sql, sqlite3_stmt* stmt);
+        std::unique_ptr<DBColumnTable> fetchColumns(const std::string& sql, sqlite3_stmt* stmt);
+        int fetchInto(const std::string& sql, sqlite3_stmt* stmt, DBDataTable& result);
+        int stepChanges(const std::string& sql, sqlite3_stmt* stmt);
+        /*steps a write to SQLITE_DONE, inside BEGIN IMMEDIATE if asked to*/
+        int stepWrite(sqlite3_stmt* stmt);
+        /*time point for m_slowQueries, left unset while the log is disabled*/
+        DBSlowQueryLog::Clock::time_point slowQueryStart() const;
+        void checkSlowQuery(sqlite3_stmt* stmt, DBSlowQueryLog::Clock::time_point start);
+        /*writes run through the query paths, which the update hook may not see*/
+        void queryWrote(sqlite3_stmt* stmt);
+        void cursorStepped(sqlite3_stmt* stmt, int err, size_t mark);
+        void cursorClosed();
+
+        /*acquire()/release() that also record lastError()*/
+        sqlite3_stmt* prepare(const std::string& sql);
+        void discard(const std::string& sql, sqlite3_stmt* stmt);
+        int setStatus(int err);
+        int execute(const std::string& sql);
+
+        /*deadline and cancel state of one public call, finishCall() takes a sqlite code*/
+        void startCall();
+        int finishCall(int err);
+        bool expired();
+        int clampToDeadline(int delayMs) const;
+        static int progressHandler(void* context);
+
+        /*change notifications of the connection, shared by every consumer*/
+        void installHooks();
+        static void updateHook(void* context, int type, const char* dbName, const char* table, long long rowid);
+        static void rollbackHook(void* context);
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+        static void preupdateHook(void* context, sqlite3* handle, int type, const char* dbName,
+                                  const char* table, long long oldRowid, long long newRowid);
+#endif
+        void tableChanged(const std::string& table);
+        /*a failed statement takes back the changes recorded since the mark*/
+        size_t changeMark() const;
+        void discardChanges(size_t mark);
+        /*after a successful call, a connection in autocommit mode has committed them,
+          unless a write statement is still running, which holds the commit back*/
+        void publishChanges();
+        bool writeInProgress() const;
+        int executeTracked(const std::string& sql);
+        void trackSavepoint(const std::string& sql);
+
+        std::unique_ptr<DBBackup> startBackup(sqlite3* destination, bool owned, int pagesPerStep, int sleepMs,
+                                              const DBBackup::ProgressHandler& handler);
+        /*bytes kept free at the end of every page, -1 when unknown*/
+        static int reserveBytes(sqlite3* handle);
+        int64_t dataVersion();
+
+        static int busyHandler(void* context, int count);
+        /*resets stmt and sleeps if a BUSY/LOCKED failure may be retried*/
+        bool retryBusy(sqlite3_stmt* stmt, int err, int attempt);
+        int backoffMs(int attempt);
+
+        sqlite3_stmt* beginBatch(const std::string& sql, bool& ownTransaction);
+        bool insertRow(sqlite3_stmt* stmt, const DBDataRow& values);
+        bool commitBatch();
+        bool endBatch(const std::string& sql, sqlite3_stmt* stmt, bool ownTransaction);
 };
 
+// arguments only have to live for the call, strings are bound without a copy.
+template<typename... Args>
+std::unique_ptr<DBDataTable> database::rawQuery(const std::string& sql, const Args&... args)
+{
+    sqlite3_stmt* stmt = prepare(sql);
+    if (stmt == NULL) {
+        return NULL;
+    }
+
+    if (bindArgs(stmt, 1, false, args...) != 0) {
+        discard(sql, stmt);
+        return NULL;
+    }
+
+    return fetchTable(sql, stmt);
+}
+
+template<typename... Args>
+int database::rawQuery(DBDataTable& result, const std::string& sql, const Args&... args)
+{
+    sqlite3_stmt* stmt = prepare(sql);
+    if (stmt == NULL) {
+        return -1;
+    }
+
+    if (bindArgs(stmt, 1, false, args...) != 0) {
+        discard(sql, stmt);
+        return -1;
+    }
+
+    return fetchInto(sql, stmt, result);
+}
+
+template<typename... Args>
+std::unique_ptr<DBColumnTable> database::rawQueryColumns(const std::string& sql, const Args&... args)
+{
+    sqlite3_stmt* stmt = prepare(sql);
+    if (stmt == NULL) {
+        return NULL;
+    }
+
+    if (bindArgs(stmt, 1, false, args...) != 0) {
+        discard(sql, stmt);
+        return NULL;
+    }
+
+    return fetchColumns(sql, stmt);
+}
+
+// strings are copied since the cursor outlives the call, views are not.
+template<typename... Args>
+std::unique_ptr<Cursor> database::rawQueryCursor(const std::string& sql, const Args&... args)
+{
+    sqlite3_stmt* stmt = prepare(sql);
+    if (stmt == NULL) {
+        return NULL;
+    }
+
+    if (bindArgs(stmt, 1, true, args...) != 0) {
+        discard(sql, stmt);
+        return NULL;
+    }
+
+    finishCall(DB_OK);
+
+    return std::unique_ptr<Cursor>(new Cursor(this, m_statements, sql, stmt));
+}
+
+template<typename T, typename... Args>
+int database::rawQueryAs(std::vector<T>& result, const std::string& sql, const Args&... args)
+{
+    return rawQueryEach<T>(sql, [&result](const T& row) { result.push_back(row); }, args...);
+}
+
+template<typename T, typename Callback, typename... Args>
+int database::rawQueryEach(const std::string& sql, Callback callback, const Args&... args)
+{
+    std::unique_ptr<Cursor> cursor = rawQueryCursor(sql, args...);
+    if (cursor == NULL) {
+        return -1;
+    }
+
+    const DBMapper<T>& mapper = DBMapper<T>::instance();
+    std::vector<int> columns;
+    mapper.resolve(*cursor, columns);
+
+    int rows = 0;
+    while (cursor->next()) {
+        T row = T();
+        mapper.read(*cursor, columns, row);
+        callback(row);
+        rows++;
+    }
+
+    return cursor->isDone() ? rows : -1;
+}
+
+template<typename... Args>
+int database::update(const std::string& table, const DBDataRow& values,
+                     const std::string& where, const Args&... whereArgs)
+{
+    std::string sql = updateSql(table, values, where);
+
+    sqlite3_stmt* stmt = prepare(sql);
+    if (stmt == NULL) {
+        return -1;
+    }
+
+    if (bindRow(stmt, values, 0) != 0
+        || bindArgs(stmt, values.getColumnCount() + 1, false, whereArgs...) != 0) {
+        discard(sql, stmt);
+        return -1;
+    }
+
+    tableChanged(table);
+
+    return stepChanges(sql, stmt);
+}
+
+template<typename... Args>
+int database::remove(const std::string& table, const std::string& where, const Args&... whereArgs)
+{
+    std::string sql = removeSql(table, where);
+
+    sqlite3_stmt* stmt = prepare(sql);
+    if (stmt == NULL) {
+        return -1;
+    }
+
+    if (bindArgs(stmt, 1, false, whereArgs...) != 0) {
+        discard(sql, stmt);
+        return -1;
+    }
+
+    tableChanged(table);
+
+    return stepChanges(sql, stmt);
+}
+
+// rows are taken from *first, column names from the first row.
+template<typename Iterator>
+int database::insertMany(const std::string& table, Iterator first, Iterator last,
+                         std::vector<int>* failedRows)
+{
+    if (first == last) {
+        return 0;
+    }
+
+    const DBDataRow& head = *first;
+    if (head.getSchema() == NULL) {
+        return -1;
+    }
+
+    std::string sql = insertSql(table, *head.getSchema());
+
+    bool ownTransaction = false;
+    sqlite3_stmt* stmt = beginBatch(sql, ownTransaction);
+    if (stmt == NULL) {
+        return -1;
+    }
+
+    int inserted = 0;
+    bool failed = false;
+    for (int i = 0; first != last; ++first, ++i) {
+        if (insertRow(stmt, *first)) {
+            inserted++;
+        }
+        else {
+            if (failedRows) {
+                failedRows->push_back(i);
+            }
+            if (m_lastError == DB_TIMEOUT || m_lastError == DB_CANCELLED) {
+                break;
+            }
+        }
+
+        if (ownTransaction && (i + 1) % m_batchSize == 0 && !commitBatch()) {
+            failed = true;
+            break;
+        }
+    }
+
+    tableChanged(table);
+
+    if (!endBatch(sql, stmt, ownTransaction) || failed) {
+        return -1;
+    }
+
+    return inserted;
+}
+
 
 }
 
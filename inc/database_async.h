@@ -0,0 +1,314 @@
+#ifndef DBASYNC_H
+#define DBASYNC_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
+#include "database.h"
+#include "database_pool.h"
+
+namespace sql
+{
+    enum DBAsyncMode
+    {
+        DBAsync_Read,
+        DBAsync_Write
+    };
+
+    /*what submit does when capacity operations are already waiting*/
+    enum DBAsyncPolicy
+    {
+        DBAsync_Block,
+        DBAsync_Reject
+    };
+
+    struct DBAsyncStats
+    {
+        uint64_t submitted;
+        uint64_t completed;
+        uint64_t rejected;
+        uint64_t blocked;     /*submits that waited for room in the queue*/
+        uint64_t maxQueued;
+        uint64_t dropped;     /*operations that threw with a callback that cannot take the exception*/
+    };
+
+    /*result type of an operation called with a database&*/
+    template<typename F>
+    struct DBAsyncResult
+    {
+        typedef decltype(std::declval<F&>()(std::declval<database&>())) type;
+    };
+
+    /*runs op on the worker and returns the completion to hand to the executor*/
+    template<typename R>
+    struct DBAsyncCall
+    {
+        template<typename F, typename Callback>
+        static std::function<void()> run(F& op, database& db, const Callback& callback)
+        {
+            std::shared_ptr<R> result(new R(op(db)));
+            return [callback, result]() mutable { callback(std::move(*result)); };
+        }
+    };
+
+    template<>
+    struct DBAsyncCall<void>
+    {
+        template<typename F, typename Callback>
+        static std::function<void()> run(F& op, database& db, const Callback& callback)
+        {
+            op(db);
+            return [callback]() mutable { callback(); };
+        }
+    };
+
+    /*whether callback(std::exception_ptr) compiles*/
+    template<typename Callback>
+    struct DBAsyncTakesError
+    {
+        template<typename C>
+        static char test(decltype(std::declval<C&>()(std::declval<std::exception_ptr>()))*);
+        template<typename C>
+        static long test(...);
+
+        static const bool value = (sizeof(test<Callback>(0)) == 1);
+    };
+
+    /*completion reporting an exception thrown by the operation, empty when the callback cannot take it*/
+    template<typename Callback, bool = DBAsyncTakesError<Callback>::value>
+    struct DBAsyncError
+    {
+        static std::function<void()> run(const Callback& callback, const std::exception_ptr& error)
+        {
+            return [callback, error]() mutable { callback(error); };
+        }
+    };
+
+    template<typename Callback>
+    struct DBAsyncError<Callback, false>
+    {
+        static std::function<void()> run(const Callback&, const std::exception_ptr&)
+        {
+            return std::function<void()>();
+        }
+    };
+
+    /**
+     * AsyncDatabase
+     *
+     * Runs operations on worker threads so the caller never blocks on sqlite.
+     * Every worker owns one connection: the write connection of a pool and a
+     * number of its read connections, or a single database that serves both.
+     * Writes run one after another on the write connection, reads on whichever
+     * read connection is free first.
+     *
+     * Results come back as std::future, or through a callback that is handed to
+     * the executor set with setExecutor(), so it can run on the caller's event
+     * loop. At most capacity operations wait at a time; submit then blocks or
+     * is rejected, see DBAsyncPolicy. A rejected submit returns an invalid
+     * future (valid() is false) or DB_REJECTED.
+     *
+     * An operation that throws hands the exception to its future, or to
+     * callback(std::exception_ptr) when the callback has such an overload;
+     * otherwise the exception is logged, counted as dropped and the callback
+     * is not called.
+     *
+     * A Session pins one connection: its operations run in submit order on
+     * that connection and nothing else runs there until the session is closed,
+     * so a transaction can span several operations.
+     */
+    class AsyncDatabase
+    {
+    private:
+        struct Strand;
+
+    public:
+        /*called with each completion, runs it wherever the caller wants*/
+        typedef std::function<void(const std::function<void()>&)> Executor;
+
+        class Session
+        {
+        public:
+            Session();
+            Session(Session&& x);
+            ~Session();
+
+            Session& operator=(Session&& x);
+
+            template<typename F>
+            std::future<typename DBAsyncResult<F>::type> submit(F op)
+            {
+                return m_async->enqueue(op, DBAsync_Write, m_strand);
+            }
+
+            template<typename F, typename Callback>
+            int submit(F op, Callback callback)
+            {
+                return m_async->enqueue(op, callback, DBAsync_Write, m_strand);
+            }
+
+            bool isValid() const
+            {
+                return (m_async != NULL);
+            }
+
+            /*operations already submitted still run, then the connection is free*/
+            void close();
+
+        private:
+            friend class AsyncDatabase;
+
+            Session(AsyncDatabase* async, const std::shared_ptr<Strand>& strand);
+
+            AsyncDatabase*          m_async;
+            std::shared_ptr<Strand> m_strand;
+
+            Session(const Session&);
+            Session& operator=(const Session&);
+        };
+
+        /*leases the writer and up to readers read connections for its lifetime*/
+        AsyncDatabase(DatabasePool& pool, int readers, size_t capacity = 1024,
+                      DBAsyncPolicy policy = DBAsync_Block);
+        /*one worker for reads and writes*/
+        AsyncDatabase(database& db, size_t capacity = 1024, DBAsyncPolicy policy = DBAsync_Block);
+        virtual ~AsyncDatabase();
+
+        /*set before submitting, without one callbacks run on the worker*/
+        void setExecutor(const Executor& executor);
+
+        template<typename F>
+        std::future<typename DBAsyncResult<F>::type> submit(F op, DBAsyncMode mode = DBAsync_Read)
+        {
+            return enqueue(op, mode, std::shared_ptr<Strand>());
+        }
+
+        /*callback(result), or callback() for an operation returning void*/
+        template<typename F, typename Callback>
+        int submit(F op, Callback callback, DBAsyncMode mode = DBAsync_Read)
+        {
+            return enqueue(op, callback, mode, std::shared_ptr<Strand>());
+        }
+
+        std::future<std::unique_ptr<DBDataTable> > rawQuery(const std::string& sql,
+                                                            const std::vector<std::string>& args);
+        std::future<int> exec(const std::string& sql);
+        std::future<int64_t> insert(const std::string& table, const DBDataRow& values);
+        std::future<int> update(const std::string& table, const DBDataRow& values,
+                                const std::string& where, const std::vector<std::string>& whereArgs);
+        std::future<int> remove(const std::string& table, const std::string& where,
+                                const std::vector<std::string>& whereArgs);
+
+        /*a read session takes a read connection, a write session the writer*/
+        Session session(DBAsyncMode mode = DBAsync_Write);
+
+        /*runs everything queued so far, then stops the workers; later submits are rejected*/
+        void stop();
+
+        DBAsyncStats getStats() const;
+
+    private:
+        typedef std::function<void(database&)> Task;
+
+        struct Worker
+        {
+            database*   db;
+            bool        reads;
+            std::thread thread;
+            /*session served by this worker, and sessions waiting for it*/
+            std::shared_ptr<Strand>             owner;
+            std::deque<std::shared_ptr<Strand> > sessions;
+        };
+
+        struct Strand
+        {
+            Worker*          worker;
+            std::deque<Task> tasks;
+            bool             closed;
+        };
+
+        size_t        m_capacity;
+        DBAsyncPolicy m_policy;
+        Executor      m_executor;
+
+        std::vector<DatabasePool::Lease> m_leases;
+        std::vector<Worker*> m_workers;
+        size_t               m_nextReader;
+
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_work;
+        std::condition_variable m_space;
+        std::deque<Task>        m_reads;
+        std::deque<Task>        m_writes;
+        size_t                  m_queued;
+        bool                    m_stopping;
+
+        DBAsyncStats m_stats;
+
+        void start();
+        void run(Worker* worker);
+        bool next(Worker* worker, std::unique_lock<std::mutex>& lock, Task& task);
+        int post(const Task& task, DBAsyncMode mode, const std::shared_ptr<Strand>& strand);
+        void complete(const std::function<void()>& completion);
+        void drop(const std::exception_ptr& error);
+        void close(const std::shared_ptr<Strand>& strand);
+
+        template<typename F>
+        std::future<typename DBAsyncResult<F>::type> enqueue(F op, DBAsyncMode mode,
+                                                             const std::shared_ptr<Strand>& strand)
+        {
+            typedef typename DBAsyncResult<F>::type R;
+
+            std::shared_ptr<std::packaged_task<R(database&)> > task(new std::packaged_task<R(database&)>(op));
+            std::future<R> future = task->get_future();
+
+            if (post([task](database& db) { (*task)(db); }, mode, strand) != DB_OK) {
+                return std::future<R>();
+            }
+
+            return future;
+        }
+
+        template<typename F, typename Callback>
+        int enqueue(F op, Callback callback, DBAsyncMode mode, const std::shared_ptr<Strand>& strand)
+        {
+            typedef typename DBAsyncResult<F>::type R;
+
+            return post([this, op, callback](database& db) mutable {
+                std::function<void()> completion;
+                try {
+                    completion = DBAsyncCall<R>::run(op, db, callback);
+                }
+                catch (...) {
+                    completion = DBAsyncError<Callback>::run(callback, std::current_exception());
+                    if (!completion) {
+                        drop(std::current_exception());
+                        return;
+                    }
+                }
+                complete(completion);
+            }, mode, strand);
+        }
+
+        AsyncDatabase(const AsyncDatabase&);
+        AsyncDatabase& operator=(const AsyncDatabase&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBASYNC_H */
+/* EOF */
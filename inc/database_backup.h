@@ -0,0 +1,89 @@
+#ifndef DBBACKUP_H
+#define DBBACKUP_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+struct sqlite3;
+struct sqlite3_backup;
+
+namespace sql
+{
+    struct DBBackupProgress
+    {
+        int      remaining;   /*pages still to copy, as of the last step*/
+        int      pageCount;   /*pages of the source, 0 before the first step*/
+        uint64_t steps;
+        uint64_t busy;        /*steps that found a database locked, they are retried*/
+    };
+
+    /**
+     * DBBackup
+     *
+     * An online backup started by database::backupTo(), copying pagesPerStep
+     * pages at a time on its own thread and sleeping between steps, so the
+     * source is only locked for the duration of one step. Writes made through
+     * the source connection are carried over while the copy runs, a write by
+     * another connection restarts it. The destination only changes when the
+     * last step commits, a failed or cancelled backup leaves it as it was.
+     *
+     * Destroying the object waits for the backup to end.
+     */
+    class DBBackup
+    {
+    public:
+        /*called on the backup thread after every step*/
+        typedef std::function<void(const DBBackupProgress&)> ProgressHandler;
+
+        virtual ~DBBackup();
+
+        /*DB_OK once every page was copied, DB_CANCELLED or DB_ERROR*/
+        int wait();
+        bool isDone() const;
+        DBBackupProgress getProgress() const;
+        /*stops after the running step*/
+        void cancel();
+
+    private:
+        friend class database;
+
+        /*least pause after a step that found the source locked*/
+        enum { BusySleepMs = 5 };
+
+        /*takes ownership of backup, and of destination when owned*/
+        DBBackup(sqlite3_backup* backup, sqlite3* destination, bool owned,
+                 int pagesPerStep, int sleepMs, const ProgressHandler& handler);
+
+        sqlite3_backup* m_backup;
+        sqlite3*        m_destination;
+        bool            m_owned;
+        int             m_pagesPerStep;
+        int             m_sleepMs;
+        ProgressHandler m_handler;
+
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_changed;
+        DBBackupProgress        m_progress;
+        bool                    m_done;
+        int                     m_result;
+        std::atomic<bool>       m_cancelled;
+        std::thread             m_thread;
+
+        void run();
+
+        DBBackup(const DBBackup&);
+        DBBackup& operator=(const DBBackup&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBBACKUP_H */
+/* EOF */
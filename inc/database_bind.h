@@ -0,0 +1,126 @@
+#ifndef DBBIND_H
+#define DBBIND_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+struct sqlite3_stmt;
+
+namespace sql
+{
+    /**
+     * DBTextView / DBBlobView
+     *
+     * Arguments bound without a copy (SQLITE_STATIC). The caller guarantees the
+     * data stays valid until the statement is reset, i.e. until the call that
+     * binds them returns, or until a cursor bound with them is closed.
+     */
+    struct DBTextView
+    {
+        const char* data;
+        size_t      length;
+
+        DBTextView(const char* d, size_t l)
+            : data(d)
+            , length(l)
+        {
+        }
+
+        explicit DBTextView(const std::string& s)
+            : data(s.data())
+            , length(s.length())
+        {
+        }
+    };
+
+    struct DBBlobView
+    {
+        const void* data;
+        size_t      size;
+
+        DBBlobView(const void* d, size_t s)
+            : data(d)
+            , size(s)
+        {
+        }
+    };
+
+    /*
+     * Native binds, return the sqlite result code. std::string and const char* are
+     * copied by sqlite when copy is true and bound in place otherwise.
+     */
+    int bindValue(sqlite3_stmt* stmt, int index, int64_t value, bool copy);
+    int bindValue(sqlite3_stmt* stmt, int index, double value, bool copy);
+    int bindValue(sqlite3_stmt* stmt, int index, const std::string& value, bool copy);
+    int bindValue(sqlite3_stmt* stmt, int index, const char* value, bool copy);
+    int bindValue(sqlite3_stmt* stmt, int index, const DBTextView& value, bool copy);
+    int bindValue(sqlite3_stmt* stmt, int index, const DBBlobView& value, bool copy);
+    int bindValue(sqlite3_stmt* stmt, int index, std::nullptr_t value, bool copy);
+
+    /**
+     * DBBinder
+     *
+     * Maps an argument type to its bind call. Integers widen to int64_t and
+     * floating point to double; specialize it to bind other types.
+     */
+    template<typename T, typename Enable = void>
+    struct DBBinder
+    {
+        static int bind(sqlite3_stmt* stmt, int index, const T& value, bool copy)
+        {
+            return bindValue(stmt, index, value, copy);
+        }
+    };
+
+    template<typename T>
+    struct DBBinder<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+    {
+        static int bind(sqlite3_stmt* stmt, int index, const T& value, bool copy)
+        {
+            return bindValue(stmt, index, static_cast<int64_t>(value), copy);
+        }
+    };
+
+    template<typename T>
+    struct DBBinder<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    {
+        static int bind(sqlite3_stmt* stmt, int index, const T& value, bool copy)
+        {
+            return bindValue(stmt, index, static_cast<double>(value), copy);
+        }
+    };
+
+    /*binds every string as text, starting at ?index*/
+    int bindStrings(sqlite3_stmt* stmt, int index, bool copy, const std::vector<std::string>& args);
+
+    inline int bindArgs(sqlite3_stmt* stmt, int index, bool copy)
+    {
+        (void)stmt;
+        (void)index;
+        (void)copy;
+        return 0;
+    }
+
+    /*binds the arguments to ?index, ?index+1, ...*/
+    template<typename T, typename... Rest>
+    int bindArgs(sqlite3_stmt* stmt, int index, bool copy, const T& value, const Rest&... rest)
+    {
+        int err = DBBinder<T>::bind(stmt, index, value, copy);
+        if (err != 0) {
+            return err;
+        }
+
+        return bindArgs(stmt, index + 1, copy, rest...);
+    }
+
+} /* namespace sql */
+
+#endif /* DBBIND_H */
+/* EOF */
@@ -0,0 +1,109 @@
+#ifndef DBCACHE_H
+#define DBCACHE_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "database_data.h"
+
+struct sqlite3;
+
+namespace sql
+{
+    struct DBResultCacheStats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t invalidations;   /*entries dropped because a table they read changed*/
+        uint64_t evictions;
+        size_t   entries;
+        size_t   bytes;
+        size_t   budget;
+    };
+
+    /**
+     * DBResultCache
+     *
+     * Query results of one connection keyed by SQL and arguments, held as
+     * immutable tables shared with the callers. Every entry remembers the
+     * tables its query reads; a change to one of them bumps that table's
+     * version, and entries filled before the bump are dropped when they are
+     * next looked up. Entries are evicted least recently used first once
+     * their approximate size exceeds the budget.
+     */
+    class DBResultCache
+    {
+    public:
+        DBResultCache(size_t budgetBytes);
+
+        void setBudget(size_t budgetBytes);
+
+        /*true on a hit, table is NULL for a cached empty result*/
+        bool lookup(const std::string& key, std::shared_ptr<const DBDataTable>& table);
+        void insert(const std::string& key, const std::shared_ptr<const DBDataTable>& table,
+                    const std::vector<std::string>& tables);
+
+        /*table names are compared without case, as sqlite does*/
+        void invalidate(const char* table);
+        void clear();
+
+        DBResultCacheStats getStats() const;
+
+        static std::string makeKey(const std::string& sql, const std::vector<std::string>& args);
+        /*tables read by sql, collected by an authorizer while preparing it once; the
+          connection's authorizer is replaced for that and removed afterwards*/
+        bool getReadTables(sqlite3* handle, const std::string& sql, std::vector<std::string>& tables);
+
+    private:
+        struct Dependency
+        {
+            std::string table;
+            uint64_t    version;
+        };
+
+        struct Entry
+        {
+            std::string key;
+            std::shared_ptr<const DBDataTable> table;
+            std::vector<Dependency> reads;
+            size_t bytes;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        size_t m_budget;
+        size_t m_bytes;
+
+        /*front is the most recently used entry*/
+        EntryList m_entries;
+        std::unordered_map<std::string, EntryList::iterator> m_index;
+        std::unordered_map<std::string, uint64_t> m_versions;
+        std::unordered_map<std::string, std::vector<std::string> > m_reads;
+
+        uint64_t m_hits;
+        uint64_t m_misses;
+        uint64_t m_invalidations;
+        uint64_t m_evictions;
+
+        uint64_t version(const std::string& table) const;
+        void erase(EntryList::iterator it);
+        void evict(size_t budget);
+
+        static std::string lower(const char* name);
+
+        DBResultCache(const DBResultCache&);
+        DBResultCache& operator=(const DBResultCache&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBCACHE_H */
+/* EOF */
@@ -0,0 +1,137 @@
+#ifndef DBCHANGE_H
+#define DBCHANGE_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+#include "database_data.h"
+
+namespace sql
+{
+    enum DBChangeOp
+    {
+        DBChange_Insert,
+        DBChange_Update,
+        DBChange_Delete
+    };
+
+    struct DBChange
+    {
+        DBChangeOp  op;
+        std::string table;
+        int64_t     rowid;
+        /*number of the committed transaction, increasing per connection*/
+        uint64_t    sequence;
+        /*column values in table order, only when values are captured*/
+        std::shared_ptr<const DBDataRow> oldValues;
+        std::shared_ptr<const DBDataRow> newValues;
+    };
+
+    /**
+     * DBChangeFeed
+     *
+     * Changes of committed transactions for one subscriber, in commit order.
+     * The connection pushes into a fixed size ring and one consumer thread
+     * polls it, neither side takes a lock. Changes that do not fit while the
+     * ring is full are dropped and counted; a consumer that sees the count
+     * grow has to resynchronise from the tables.
+     */
+    class DBChangeFeed
+    {
+    public:
+        /*called on the writing thread after a commit was pushed, must not use the connection*/
+        typedef std::function<void()> Notify;
+
+        /*capacity is rounded up to a power of two*/
+        DBChangeFeed(size_t capacity, const Notify& notify);
+
+        /*consumer side, from one thread at a time*/
+        bool poll(DBChange& change);
+        uint64_t getDropped() const;
+        /*the connection was closed or the feed unsubscribed, nothing more is pushed*/
+        bool isClosed() const;
+
+    private:
+        friend class DBChangeLog;
+
+        std::vector<DBChange> m_slots;
+        size_t                m_mask;
+        Notify                m_notify;
+
+        /*kept a cache line apart, each is written by one side only*/
+        std::atomic<size_t> m_head;
+        char                m_padding[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> m_tail;
+        std::atomic<uint64_t> m_dropped;
+        std::atomic<bool>     m_closed;
+
+        bool push(const DBChange& change);
+        void close();
+
+        DBChangeFeed(const DBChangeFeed&);
+        DBChangeFeed& operator=(const DBChangeFeed&);
+    };
+
+    /**
+     * DBChangeLog
+     *
+     * Row changes of the open transaction of one connection. They are handed
+     * to the feeds once the connection is back in autocommit mode after a
+     * successful call, that is after the commit succeeded, and discarded when
+     * the transaction, a savepoint or a failed statement is rolled back.
+     */
+    class DBChangeLog
+    {
+    public:
+        DBChangeLog();
+        virtual ~DBChangeLog();
+
+        std::shared_ptr<DBChangeFeed> subscribe(size_t capacity, const DBChangeFeed::Notify& notify);
+        void unsubscribe(const std::shared_ptr<DBChangeFeed>& feed);
+        bool hasSubscribers() const;
+        bool hasPending() const;
+
+        void record(DBChangeOp op, const char* table, int64_t rowid,
+                    const std::shared_ptr<const DBDataRow>& oldValues,
+                    const std::shared_ptr<const DBDataRow>& newValues);
+
+        /*position to discard back to when the statement about to run fails*/
+        size_t mark() const;
+        void truncate(size_t mark);
+
+        void savepoint(const std::string& name);
+        void release(const std::string& name);
+        void rollbackTo(const std::string& name);
+
+        /*every change recorded so far has been committed*/
+        void publish();
+        void rollback();
+
+    private:
+        struct Savepoint
+        {
+            std::string name;
+            size_t      mark;
+        };
+
+        std::vector<DBChange>  m_pending;
+        std::vector<Savepoint> m_savepoints;
+        std::vector<std::shared_ptr<DBChangeFeed> > m_feeds;
+        uint64_t m_sequence;
+
+        DBChangeLog(const DBChangeLog&);
+        DBChangeLog& operator=(const DBChangeLog&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBCHANGE_H */
+/* EOF */
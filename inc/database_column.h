@@ -0,0 +1,98 @@
+#ifndef DBCOLUMN_H
+#define DBCOLUMN_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "database_data.h"
+
+namespace sql
+{
+    /**
+     * DBColumnTable
+     *
+     * Column-major result set. Every column keeps its values in one contiguous
+     * typed array plus a null bitmap; TEXT and BLOB values share one byte buffer
+     * addressed through an offsets array. A column takes the type of its first
+     * non-null value, later values are converted to it the way sqlite3_column_*
+     * converts. Null slots hold 0 or an empty string.
+     */
+    class DBColumnTable
+    {
+    public:
+        DBColumnTable(int columnCount);
+        DBColumnTable(DBColumnTable&& x);
+        virtual ~DBColumnTable();
+
+        DBColumnTable& operator=(DBColumnTable&& x);
+
+        int getRowCount() const;
+        int getColumnCount() const;
+        bool setColumnName(int column, const char* name);
+        const std::string& getColumnName(int column) const;
+        DBDataType getColumnType(int column) const;
+
+        /*values are appended to the last row added*/
+        void addRow();
+        bool putBlob(int column, const void* value, size_t size);
+        bool putString(int column, const char* value, size_t length);
+        bool putLong(int column, int64_t value);
+        bool putDouble(int column, double value);
+        bool putNull(int column);
+
+        bool isNull(int row, int column) const;
+        int64_t getLong(int row, int column) const;
+        double getDouble(int row, int column) const;
+        const char* getString(int row, int column, size_t& length) const;
+        const void* getBlob(int row, int column, size_t& size) const;
+
+        /*whole column access for scans, NULL if the column has another type*/
+        const int64_t* getLongColumn(int column) const;
+        const double* getDoubleColumn(int column) const;
+        /*bit (row % 8) of byte (row / 8) is set for null rows*/
+        const uint8_t* getNullBitmap(int column) const;
+
+    private:
+        struct Column
+        {
+            std::string name;
+            DBDataType  type;
+            int         size;
+
+            std::vector<int64_t>  longs;
+            std::vector<double>   doubles;
+            /*offsets[row] to offsets[row + 1] in bytes*/
+            std::vector<size_t>   offsets;
+            std::vector<char>     bytes;
+            std::vector<uint8_t>  nulls;
+
+            Column()
+                : name()
+                , type(DBDataType_Null)
+                , size(0)
+            {
+            }
+        };
+
+        int m_rowCount;
+        std::vector<Column> m_columns;
+
+        Column* next(int column, DBDataType type);
+        void settle(Column& col, DBDataType type);
+        void pad(Column& col);
+        void markNull(Column& col);
+
+        DBColumnTable();
+        DBColumnTable(const DBColumnTable&);
+        DBColumnTable& operator=(const DBColumnTable&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBCOLUMN_H */
+/* EOF */
@@ -0,0 +1,345 @@
+#ifndef DBCORO_H
+#define DBCORO_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+/*the library builds as C++11, only translation units compiled as C++20 see this header's contents*/
+#if defined(__cpp_impl_coroutine)
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <coroutine>
+#include <utility>
+#include <exception>
+
+#include "database_async.h"
+
+namespace sql
+{
+    /**
+     * DBAwaitable
+     *
+     * co_await runs the operation on an AsyncDatabase worker and resumes the
+     * coroutine with its result. The coroutine is resumed where the completion
+     * runs: on the worker, or on the executor set with setExecutor(). When the
+     * queue rejects the operation the coroutine continues at once with the
+     * fallback value, -1 or NULL for the operations of CoDatabase. An exception
+     * thrown by the operation is rethrown from the co_await.
+     */
+    template<typename T>
+    class DBAwaitable
+    {
+    public:
+        typedef std::function<T(database&)> Operation;
+
+        DBAwaitable(AsyncDatabase& async, const Operation& op, DBAsyncMode mode, T fallback)
+            : m_async(&async)
+            , m_session(NULL)
+            , m_op(op)
+            , m_mode(mode)
+            , m_result(std::move(fallback))
+            , m_error()
+        {
+        }
+
+        DBAwaitable(AsyncDatabase::Session& session, const Operation& op, T fallback)
+            : m_async(NULL)
+            , m_session(&session)
+            , m_op(op)
+            , m_mode(DBAsync_Read)
+            , m_result(std::move(fallback))
+            , m_error()
+        {
+        }
+
+        bool await_ready() const
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            // the callback may resume the coroutine before submit returns, this must not be touched after it.
+            Resume callback;
+            callback.result = &m_result;
+            callback.error = &m_error;
+            callback.handle = handle;
+
+            int err = DB_REJECTED;
+            if (m_session) {
+                err = m_session->isValid() ? m_session->submit(m_op, callback) : DB_REJECTED;
+            }
+            else {
+                err = m_async->submit(m_op, callback, m_mode);
+            }
+
+            return (err == DB_OK);
+        }
+
+        T await_resume()
+        {
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+
+            return std::move(m_result);
+        }
+
+    private:
+        /*the operation's result, or the exception it threw*/
+        struct Resume
+        {
+            T* result;
+            std::exception_ptr* error;
+            std::coroutine_handle<> handle;
+
+            void operator()(T value) const
+            {
+                *result = std::move(value);
+                handle.resume();
+            }
+
+            void operator()(std::exception_ptr e) const
+            {
+                *error = e;
+                handle.resume();
+            }
+        };
+
+        AsyncDatabase*          m_async;
+        AsyncDatabase::Session* m_session;
+        Operation   m_op;
+        DBAsyncMode m_mode;
+        T           m_result;
+        std::exception_ptr m_error;
+    };
+
+    /**
+     * DBAsyncCursor
+     *
+     * Rows of one query handed out in batches: each co_await next() steps up to
+     * batchRows rows on a read session and resumes with them as a DBDataTable,
+     * or with NULL once every row has been read or the query failed. The
+     * statement stays open on its connection between batches, so the cursor
+     * keeps that connection until it is destroyed.
+     */
+    class DBAsyncCursor
+    {
+    public:
+        typedef std::function<std::unique_ptr<Cursor>(database&)> Opener;
+
+        DBAsyncCursor(AsyncDatabase& async, const Opener& open, int batchRows = 256)
+            : m_session(async.session(DBAsync_Read))
+            , m_state(new State())
+        {
+            m_state->open = open;
+            m_state->batchRows = batchRows > 0 ? batchRows : 1;
+            m_state->done = false;
+            m_state->error = DB_OK;
+        }
+
+        virtual ~DBAsyncCursor()
+        {
+            // the statement goes back to its cache on the connection's own worker.
+            std::shared_ptr<State> state = m_state;
+            if (m_session.isValid()) {
+                m_session.submit([state](database&) { state->cursor.reset(); });
+            }
+        }
+
+        void setBatchRows(int rows)
+        {
+            m_state->batchRows = rows > 0 ? rows : 1;
+        }
+
+        DBAwaitable<std::unique_ptr<DBDataTable> > next()
+        {
+            std::shared_ptr<State> state = m_state;
+            return DBAwaitable<std::unique_ptr<DBDataTable> >(m_session, [state](database& db) {
+                return fetch(*state, db);
+            }, std::unique_ptr<DBDataTable>());
+        }
+
+        /*read after next() resumed: every row was read, or the query failed*/
+        bool isDone() const
+        {
+            return m_state->done;
+        }
+
+        /*DB_OK, or the lastError() of opening the cursor, or the sqlite code it stopped with*/
+        int getError() const
+        {
+            return m_state->error;
+        }
+
+    private:
+        struct State
+        {
+            Opener open;
+            std::unique_ptr<Cursor> cursor;
+            int  batchRows;
+            bool done;
+            int  error;
+        };
+
+        AsyncDatabase::Session m_session;
+        std::shared_ptr<State> m_state;
+
+        static std::unique_ptr<DBDataTable> fetch(State& state, database& db)
+        {
+            if (state.done) {
+                return NULL;
+            }
+
+            if (!state.cursor) {
+                state.cursor = state.open(db);
+                if (!state.cursor) {
+                    state.done = true;
+                    state.error = db.lastError();
+                    return NULL;
+                }
+            }
+
+            Cursor& cursor = *state.cursor;
+            int columns = cursor.getColumnCount();
+            std::unique_ptr<DBDataTable> batch(new DBDataTable(columns));
+            for (int i = 0; i < columns; i++) {
+                batch->setColumnName(i, cursor.getColumnName(i));
+            }
+
+            int rows = 0;
+            while (rows < state.batchRows && cursor.next()) {
+                batch->addRow();
+                for (int i = 0; i < columns; i++) {
+                    size_t size = 0;
+                    DBDataType type = cursor.getType(i);
+                    batch->setColumnType(i, type);
+                    switch (type) {
+                    case DBDataType_Integer:
+                        batch->putLong(rows, i, cursor.getLong(i));
+                        break;
+                    case DBDataType_Float:
+                        batch->putDouble(rows, i, cursor.getDouble(i));
+                        break;
+                    case DBDataType_String:
+                    {
+                        const char* text = cursor.getString(i, size);
+                        batch->putString(rows, i, text, size + 1);
+                        break;
+                    }
+                    case DBDataType_Blob:
+                    {
+                        const void* blob = cursor.getBlob(i, size);
+                        batch->putBlob(rows, i, blob, size);
+                        break;
+                    }
+                    case DBDataType_Null:
+                    default:
+                        batch->putNull(rows, i);
+                        break;
+                    }
+                }
+                rows++;
+            }
+
+            if (rows < state.batchRows) {
+                // end of the rows or an error, either way the statement is finished.
+                state.done = true;
+                state.error = cursor.isDone() ? DB_OK : cursor.getError();
+                state.cursor.reset();
+            }
+
+            if (rows == 0) {
+                return NULL;
+            }
+
+            return batch;
+        }
+
+        DBAsyncCursor(const DBAsyncCursor&);
+        DBAsyncCursor& operator=(const DBAsyncCursor&);
+    };
+
+    /**
+     * CoDatabase
+     *
+     * Awaitable counterparts of the database calls, run through an AsyncDatabase.
+     * Arguments are copied into the operation, except C strings, which must stay
+     * valid until the co_await has resumed.
+     */
+    class CoDatabase
+    {
+    public:
+        CoDatabase(AsyncDatabase& async)
+            : m_async(async)
+        {
+        }
+
+        template<typename... Args>
+        DBAwaitable<std::unique_ptr<DBDataTable> > rawQuery(const std::string& sql, const Args&... args)
+        {
+            return DBAwaitable<std::unique_ptr<DBDataTable> >(m_async, [sql, args...](database& db) {
+                return db.rawQuery(sql, args...);
+            }, DBAsync_Read, std::unique_ptr<DBDataTable>());
+        }
+
+        DBAwaitable<std::unique_ptr<DBDataTable> > query(const std::string& table, const std::vector<std::string>& columns,
+                                                        const std::string& where, const std::vector<std::string>& whereArgs,
+                                                        const std::string& orderBy)
+        {
+            return DBAwaitable<std::unique_ptr<DBDataTable> >(m_async, [table, columns, where, whereArgs, orderBy](database& db) {
+                return db.query(table, columns, where, whereArgs, orderBy);
+            }, DBAsync_Read, std::unique_ptr<DBDataTable>());
+        }
+
+        DBAwaitable<int64_t> insert(const std::string& table, const DBDataRow& values)
+        {
+            return DBAwaitable<int64_t>(m_async, [table, values](database& db) {
+                return db.insert(table, values);
+            }, DBAsync_Write, -1);
+        }
+
+        template<typename... Args>
+        DBAwaitable<int> update(const std::string& table, const DBDataRow& values,
+                                const std::string& where, const Args&... whereArgs)
+        {
+            return DBAwaitable<int>(m_async, [table, values, where, whereArgs...](database& db) {
+                return db.update(table, values, where, whereArgs...);
+            }, DBAsync_Write, -1);
+        }
+
+        template<typename... Args>
+        DBAwaitable<int> remove(const std::string& table, const std::string& where, const Args&... whereArgs)
+        {
+            return DBAwaitable<int>(m_async, [table, where, whereArgs...](database& db) {
+                return db.remove(table, where, whereArgs...);
+            }, DBAsync_Write, -1);
+        }
+
+        /*rows in batches of batchRows, see DBAsyncCursor*/
+        template<typename... Args>
+        std::unique_ptr<DBAsyncCursor> rawQueryCursor(int batchRows, const std::string& sql, const Args&... args)
+        {
+            return std::unique_ptr<DBAsyncCursor>(new DBAsyncCursor(m_async, [sql, args...](database& db) {
+                return db.rawQueryCursor(sql, args...);
+            }, batchRows));
+        }
+
+    private:
+        AsyncDatabase& m_async;
+
+        CoDatabase(const CoDatabase&);
+        CoDatabase& operator=(const CoDatabase&);
+    };
+
+} /* namespace sql */
+
+#endif /* __cpp_impl_coroutine */
+
+#endif /* DBCORO_H */
+/* EOF */
@@ -0,0 +1,71 @@
+#ifndef DBCURSOR_H
+#define DBCURSOR_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+
+#include "database_data.h"
+
+struct sqlite3_stmt;
+
+namespace sql
+{
+    class DBStatementCache;
+    class database;
+
+    /**
+     * Cursor
+     *
+     * Forward-only view over a running query. Values are read straight from the
+     * statement and stay valid until the next call to next(). The statement goes
+     * back to the statement cache when the cursor is closed or destroyed, so a
+     * cursor must not outlive the database that created it.
+     */
+    class Cursor
+    {
+    public:
+        Cursor(database* owner, DBStatementCache* cache, const std::string& sql, sqlite3_stmt* stmt);
+        virtual ~Cursor();
+
+        /*false from the end of the rows or the first error on, the query is not run again*/
+        bool next();
+        void close();
+        bool isClosed() const;
+
+        /*last sqlite result code of next()*/
+        int getError() const;
+        /*true once every row has been read without error*/
+        bool isDone() const;
+
+        int getColumnCount() const;
+        const char* getColumnName(int column) const;
+        int getColumnIndex(const std::string& name) const;
+
+        DBDataType getType(int column) const;
+        bool isNull(int column) const;
+        int64_t getLong(int column) const;
+        double getDouble(int column) const;
+        const char* getString(int column, size_t& length) const;
+        const void* getBlob(int column, size_t& size) const;
+
+    private:
+        /*told about every step, a write may run through a cursor*/
+        database*     m_owner;
+        DBStatementCache* m_cache;
+        std::string   m_sql;
+        sqlite3_stmt* m_stmt;
+        int           m_columnCount;
+        int           m_error;
+
+        Cursor(const Cursor&);
+        Cursor& operator=(const Cursor&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBCURSOR_H */
+/* EOF */
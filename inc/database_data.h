@@ -8,6 +8,8 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include <memory>
+#include <unordered_map>
 #include <cstring>
 
 namespace sql
@@ -21,57 +23,135 @@ namespace sql
         DBDataType_Blob = 4
     };
 
+    /**
+     * DBDataArena
+     *
+     * Bump allocator for cell payloads. Memory is handed out from large chunks
+     * and given back all at once: reset() rewinds and keeps the chunks for the
+     * next fill, release() frees them.
+     */
+    class DBDataArena
+    {
+    public:
+        DBDataArena(size_t chunkSize = 64 * 1024);
+        DBDataArena(DBDataArena&& x);
+        ~DBDataArena();
+
+        DBDataArena& operator=(DBDataArena&& x);
+
+        void* allocate(size_t size);
+        void reset();
+        void release();
+
+        size_t getUsed() const;
+        size_t getCapacity() const;
+
+    private:
+        struct Chunk
+        {
+            char*  data;
+            size_t size;
+        };
+
+        std::vector<Chunk> m_chunks;
+        size_t m_chunkSize;
+        size_t m_current;
+        size_t m_offset;
+        size_t m_used;
+
+        DBDataArena(const DBDataArena&);
+        DBDataArena& operator=(const DBDataArena&);
+    };
+
+    /**
+     * DBDataSchema
+     *
+     * Column names of a row layout, stored once and shared by every row that
+     * uses the layout. A cell's name is the name at its column index.
+     */
+    class DBDataSchema
+    {
+    public:
+        DBDataSchema(int columnCount);
+
+        int getColumnCount() const;
+        bool setColumnName(int column, const char* name);
+        const std::string& getColumnName(int column) const;
+        /*-1 if no column has this name*/
+        int getColumnIndex(const std::string& name) const;
+        /*"A, B, C", built once per change*/
+        const std::string& getColumnList() const;
+
+    private:
+        std::vector<std::string> m_names;
+        std::unordered_map<std::string, int> m_index;
+        mutable std::string m_columnList;
+        mutable bool m_columnListValid;
+    };
+
+    /**
+     * DBDataCell
+     *
+     * One value of a row. Strings and blobs that fit in the cell are stored
+     * inline, larger ones go to the arena given to put or onto the heap.
+     */
     class DBDataCell
     {
     public:
         DBDataCell();
-        DBDataCell(const std::string& name);
         DBDataCell(const DBDataCell& x);
+        DBDataCell(DBDataCell&& x);
         ~DBDataCell();
 
         bool operator==(const DBDataCell& x) const;
         bool operator!=(const DBDataCell& x) const;
         DBDataCell& operator=(const DBDataCell& x);
+        DBDataCell& operator=(DBDataCell&& x);
 
-        bool putBlob(const void* value, size_t size);
-        bool putString(const char* value, size_t length);
-        bool putLong(int value);
+        /*payload copied into arena when given, onto the heap otherwise*/
+        bool putBlob(const void* value, size_t size, DBDataArena* arena = NULL);
+        bool putString(const char* value, size_t length, DBDataArena* arena = NULL);
+        bool putLong(int64_t value);
         bool putDouble(double value);
         bool putNull();
 
         DBDataType type() const;
-        int getLong() const;
+        int64_t getLong() const;
         double getDouble() const;
         const char* getString(size_t& length) const;
         const void* getBlob(size_t& outSize) const;
 
-        const std::string& getName() const
-        {
-            return m_name;
-        }
-
-        void setName(const char* name)
+    private:
+        enum Storage
         {
-            m_name.assign(name, strlen(name));
-        }
+            Storage_Heap = 0,
+            /*buffer belongs to an arena and is not freed by the cell*/
+            Storage_Arena = 1,
+            /*payload kept in data.local, inlineSize bytes*/
+            Storage_Inline = 2
+        };
 
-    private:
         struct Cell
         {
             DBDataType type;
+            uint8_t storage;
+            uint8_t inlineSize;
             union
             {
                 double d;
-                int l;
+                int64_t l;
                 struct
                 {
                     void * ptr;
                     size_t size;
                 } buffer;
+                char local[sizeof(void*) + sizeof(size_t)];
             } data;
 
             Cell()
             : type(DBDataType_Null)
+            , storage(Storage_Heap)
+            , inlineSize(0)
             {
                 memset(&data, 0, sizeof(data));
             }
@@ -79,7 +159,9 @@ namespace sql
 
         Cell m_cell;
 
-        std::string m_name;
+        bool put(DBDataType type, const void* value, size_t size, bool terminate, DBDataArena* arena);
+        const void* payload() const;
+        size_t payloadSize() const;
     };
 
     /**
@@ -90,31 +172,43 @@ namespace sql
     class DBDataRow
     {
     public:
-        DBDataRow(int columnCount);
+        DBDataRow(int columnCount, DBDataArena* arena = NULL);
+        /*rows built from one schema share its column names, no name per put needed*/
+        DBDataRow(const std::shared_ptr<DBDataSchema>& schema, DBDataArena* arena = NULL);
         DBDataRow(const DBDataRow& x);
+        DBDataRow(DBDataRow&& x);
         virtual ~DBDataRow();
 
         bool operator==(const DBDataRow& x) const;
         DBDataRow& operator=(const DBDataRow& x);
+        DBDataRow& operator=(DBDataRow&& x);
 
         bool putBlob(int index, const void* value, size_t size, const char* name = NULL);
         bool putString(int index, const char* value, size_t length, const char* name = NULL);
-        bool putLong(int index, int value, const char* name = NULL);
+        bool putLong(int index, int64_t value, const char* name = NULL);
         bool putDouble(int index, double value, const char* name = NULL);
         bool putNull(int index, const char* name = NULL);
 
         int getColumnCount() const;
         DBDataType type(int index) const;
-        int getLong(int index) const;
+        int64_t getLong(int index) const;
         double getDouble(int index) const;
         const char* getString(int index, size_t& length) const;
         const void* getBlob(int index, size_t& size) const;
 
         const std::string& getColumnName(int index) const;
+        int getColumnIndex(const std::string& name) const;
+        const DBDataSchema* getSchema() const;
 
     private:
+        friend class DBDataTable;
+
         int m_count;
         DBDataCell* m_cells;
+        DBDataArena* m_arena;
+        std::shared_ptr<DBDataSchema> m_schema;
+
+        void setColumnName(int index, const char* name);
 
         DBDataRow();
     };
@@ -129,34 +223,48 @@ namespace sql
     public:
         DBDataTable(int columnCount);
         DBDataTable(int rowCount, int columnCount);
+        DBDataTable(DBDataTable&& x);
         virtual ~DBDataTable();
 
+        DBDataTable& operator=(DBDataTable&& x);
+
         bool setRowCount(int rowCount);
-        int getRowCount();
+        int getRowCount() const;
         bool setColumnCount(int columnCount);
-        int getColumnCount();
+        int getColumnCount() const;
         bool setColumnType(int column, DBDataType type);
-        DBDataType getColumnType(int column);
+        DBDataType getColumnType(int column) const;
+        bool setColumnName(int column, const char* name);
+        const std::string& getColumnName(int column) const;
+        int getColumnIndex(const std::string& name) const;
+        const DBDataSchema* getSchema() const;
+        /*drops rows and columns, payload memory is kept for the next fill*/
         bool reset();
         void addRow();
+        /*approximate bytes held by the table, payloads included*/
+        size_t getMemoryUsage() const;
+
+        const DBDataRow* getRow(int row) const;
 
         bool putBlob(int row, int column, const void* value, size_t size);
         bool putString(int row, int column, const char* value, size_t len);
-        bool putLong(int row, int column, int value);
+        bool putLong(int row, int column, int64_t value);
         bool putDouble(int row, int column, double value);
         bool putNull(int row, int column);
 
-        DBDataType getType(int row, int column);
-        int getLong(int row, int column);
-        double getDouble(int row, int column);
-        const char* getString(int row, int column, size_t& length);
-        const void* getBlob(int row, int column, size_t& size);
+        DBDataType getType(int row, int column) const;
+        int64_t getLong(int row, int column) const;
+        double getDouble(int row, int column) const;
+        const char* getString(int row, int column, size_t& length) const;
+        const void* getBlob(int row, int column, size_t& size) const;
 
     private:
         /*vector store smart pointer*/
         std::vector<DBDataRow*>  m_rowSpList;
         int    m_columnCount;
         DBDataType*     m_columnTypes;
+        std::shared_ptr<DBDataSchema> m_schema;
+        DBDataArena m_arena;
 
         DBDataTable();
         DBDataTable(const DBDataTable&);
@@ -0,0 +1,233 @@
+#ifndef DBLOG_H
+#define DBLOG_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+/*levels below DBLOG_MIN_LEVEL are compiled out, set it with -DDBLOG_MIN_LEVEL=0..4*/
+#define DBLOG_LEVEL_DEBUG 0
+#define DBLOG_LEVEL_INFO  1
+#define DBLOG_LEVEL_WARN  2
+#define DBLOG_LEVEL_ERROR 3
+#define DBLOG_LEVEL_NONE  4
+
+#ifndef DBLOG_MIN_LEVEL
+#    define DBLOG_MIN_LEVEL DBLOG_LEVEL_INFO
+#endif
+
+namespace sql
+{
+    enum DBLogLevel
+    {
+        DBLogLevel_Debug = DBLOG_LEVEL_DEBUG,
+        DBLogLevel_Info = DBLOG_LEVEL_INFO,
+        DBLogLevel_Warn = DBLOG_LEVEL_WARN,
+        DBLogLevel_Error = DBLOG_LEVEL_ERROR,
+        DBLogLevel_None = DBLOG_LEVEL_NONE
+    };
+
+    /*one log call, message is built by format() on demand*/
+    struct DBLogRecord
+    {
+        DBLogLevel  level;
+        const char* tag;
+        std::chrono::system_clock::time_point time;
+        std::function<std::string()> format;
+    };
+
+    /**
+     * DBLogSink
+     *
+     * Receives every record at or above the runtime level. write() is called
+     * on the logging thread and must not block for long.
+     */
+    class DBLogSink
+    {
+    public:
+        virtual ~DBLogSink() {}
+        virtual void write(const DBLogRecord& record) = 0;
+    };
+
+    /**
+     * DBStreamLogSink
+     *
+     * Formats and writes each record to a FILE* on the calling thread.
+     */
+    class DBStreamLogSink : public DBLogSink
+    {
+    public:
+        DBStreamLogSink(FILE* stream = stderr);
+
+        virtual void write(const DBLogRecord& record);
+
+        static std::string line(const DBLogRecord& record);
+
+    private:
+        FILE* m_stream;
+    };
+
+    /**
+     * DBAsyncLogSink
+     *
+     * Queues records and formats them on a background thread, which hands the
+     * result to the wrapped sink. The caller only copies the arguments. When
+     * more than capacity records are waiting new ones are dropped and counted
+     * instead of blocking the caller.
+     */
+    class DBAsyncLogSink : public DBLogSink
+    {
+    public:
+        DBAsyncLogSink(const std::shared_ptr<DBLogSink>& target, size_t capacity = 4096);
+        virtual ~DBAsyncLogSink();
+
+        virtual void write(const DBLogRecord& record);
+
+        /*waits until every queued record has been written*/
+        void flush();
+        uint64_t getDropped() const;
+
+    private:
+        std::shared_ptr<DBLogSink> m_target;
+        size_t m_capacity;
+
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_idle;
+        std::deque<DBLogRecord> m_queue;
+        bool     m_busy;
+        bool     m_stopping;
+        uint64_t m_dropped;
+        std::thread m_thread;
+
+        void run();
+
+        DBAsyncLogSink(const DBAsyncLogSink&);
+        DBAsyncLogSink& operator=(const DBAsyncLogSink&);
+    };
+
+    /**
+     * DBLog
+     *
+     * Process wide logger of the wrapper. Defaults to warnings and errors on
+     * stderr; setSink(NULL) silences it.
+     */
+    class DBLog
+    {
+    public:
+        static void setSink(const std::shared_ptr<DBLogSink>& sink);
+        static void setLevel(DBLogLevel level);
+        static DBLogLevel getLevel();
+
+        static bool isEnabled(DBLogLevel level);
+        static void write(DBLogLevel level, const char* tag, const std::function<std::string()>& format);
+    };
+
+    /*arguments are copied into the record, C strings as std::string*/
+    template<typename T>
+    struct DBLogValue
+    {
+        typedef T type;
+        static const T& get(const T& value) { return value; }
+    };
+
+    template<>
+    struct DBLogValue<const char*>
+    {
+        typedef std::string type;
+    };
+
+    template<>
+    struct DBLogValue<char*>
+    {
+        typedef std::string type;
+    };
+
+    template<>
+    struct DBLogValue<std::string>
+    {
+        typedef std::string type;
+        static const char* get(const std::string& value) { return value.c_str(); }
+    };
+
+    template<typename... Args>
+    std::string dbLogFormat(const char* format, const Args&... args)
+    {
+        char buffer[256];
+        int length = snprintf(buffer, sizeof(buffer), format, DBLogValue<Args>::get(args)...);
+        if (length < 0) {
+            return std::string();
+        }
+        if (static_cast<size_t>(length) < sizeof(buffer)) {
+            return std::string(buffer, length);
+        }
+
+        std::string result(length + 1, '\0');
+        snprintf(&result[0], result.size(), format, DBLogValue<Args>::get(args)...);
+        result.resize(length);
+
+        return result;
+    }
+
+    inline std::string dbLogCopy(const char* value)
+    {
+        return value ? value : "(null)";
+    }
+
+    template<typename T>
+    const T& dbLogCopy(const T& value)
+    {
+        return value;
+    }
+
+    template<typename... Args>
+    void dbLog(DBLogLevel level, const char* tag, const char* format, const Args&... args)
+    {
+        if (!DBLog::isEnabled(level)) {
+            return;
+        }
+
+        DBLog::write(level, tag, std::bind(&dbLogFormat<typename DBLogValue<typename std::decay<Args>::type>::type...>,
+                                           format, dbLogCopy(args)...));
+    }
+
+} /* namespace sql */
+
+/*printf style, the format must be a literal; define LOG_TAG before including*/
+#ifdef LOG_TAG
+#    if DBLOG_MIN_LEVEL <= DBLOG_LEVEL_DEBUG
+#        define LOGD(...) ::sql::dbLog(::sql::DBLogLevel_Debug, LOG_TAG, __VA_ARGS__)
+#    else
+#        define LOGD(...) do {} while (0)
+#    endif
+#    if DBLOG_MIN_LEVEL <= DBLOG_LEVEL_INFO
+#        define LOGI(...) ::sql::dbLog(::sql::DBLogLevel_Info, LOG_TAG, __VA_ARGS__)
+#    else
+#        define LOGI(...) do {} while (0)
+#    endif
+#    if DBLOG_MIN_LEVEL <= DBLOG_LEVEL_WARN
+#        define LOGW(...) ::sql::dbLog(::sql::DBLogLevel_Warn, LOG_TAG, __VA_ARGS__)
+#    else
+#        define LOGW(...) do {} while (0)
+#    endif
+#    if DBLOG_MIN_LEVEL <= DBLOG_LEVEL_ERROR
+#        define LOGE(...) ::sql::dbLog(::sql::DBLogLevel_Error, LOG_TAG, __VA_ARGS__)
+#    else
+#        define LOGE(...) do {} while (0)
+#    endif
+#endif
+
+#endif /* DBLOG_H */
+/* EOF */
@@ -0,0 +1,193 @@
+#ifndef DBMAPPING_H
+#define DBMAPPING_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "database_cursor.h"
+
+namespace sql
+{
+    /**
+     * DBColumnReader
+     *
+     * Reads one column of the current cursor row into a field. Integers and
+     * floating point read the native value, std::string reads TEXT and
+     * std::vector<char/unsigned char> reads BLOB. Specialize it for other types.
+     */
+    template<typename M, typename Enable = void>
+    struct DBColumnReader;
+
+    template<typename M>
+    struct DBColumnReader<M, typename std::enable_if<std::is_integral<M>::value || std::is_enum<M>::value>::type>
+    {
+        static void read(const Cursor& cursor, int column, M& value)
+        {
+            value = static_cast<M>(cursor.getLong(column));
+        }
+    };
+
+    template<typename M>
+    struct DBColumnReader<M, typename std::enable_if<std::is_floating_point<M>::value>::type>
+    {
+        static void read(const Cursor& cursor, int column, M& value)
+        {
+            value = static_cast<M>(cursor.getDouble(column));
+        }
+    };
+
+    template<>
+    struct DBColumnReader<std::string>
+    {
+        static void read(const Cursor& cursor, int column, std::string& value)
+        {
+            size_t length = 0;
+            const char* text = cursor.getString(column, length);
+            if (text) {
+                value.assign(text, length);
+            }
+            else {
+                value.clear();
+            }
+        }
+    };
+
+    template<typename B>
+    struct DBColumnReader<std::vector<B>, typename std::enable_if<sizeof(B) == 1>::type>
+    {
+        static void read(const Cursor& cursor, int column, std::vector<B>& value)
+        {
+            size_t size = 0;
+            const B* blob = static_cast<const B*>(cursor.getBlob(column, size));
+            if (blob) {
+                value.assign(blob, blob + size);
+            }
+            else {
+                value.clear();
+            }
+        }
+    };
+
+    template<typename T>
+    class DBMapper;
+
+    /**
+     * DBMapping
+     *
+     * Declares which column fills which field of T, once per struct:
+     *
+     *     template<> struct DBMapping<Employee>
+     *     {
+     *         static void map(DBMapper<Employee>& m)
+     *         {
+     *             m.field("ID", &Employee::id);
+     *             m.field("NAME", &Employee::name);
+     *         }
+     *     };
+     */
+    template<typename T>
+    struct DBMapping;
+
+    /**
+     * DBMapper
+     *
+     * Field list built once from DBMapping<T>. Column indices are resolved by
+     * name once per statement; every row then reads straight from the cursor.
+     * Fields whose column is missing from the result are left untouched.
+     */
+    template<typename T>
+    class DBMapper
+    {
+    public:
+        static const DBMapper& instance()
+        {
+            static const DBMapper mapper(true);
+            return mapper;
+        }
+
+        ~DBMapper()
+        {
+            for (size_t i = 0; i < m_fields.size(); i++) {
+                delete m_fields[i];
+            }
+        }
+
+        template<typename M>
+        void field(const char* column, M T::*member)
+        {
+            m_fields.push_back(new Field<M>(column, member));
+        }
+
+        void resolve(const Cursor& cursor, std::vector<int>& columns) const
+        {
+            columns.resize(m_fields.size());
+            for (size_t i = 0; i < m_fields.size(); i++) {
+                columns[i] = cursor.getColumnIndex(m_fields[i]->column);
+            }
+        }
+
+        void read(const Cursor& cursor, const std::vector<int>& columns, T& object) const
+        {
+            for (size_t i = 0; i < m_fields.size(); i++) {
+                if (columns[i] >= 0) {
+                    m_fields[i]->read(cursor, columns[i], object);
+                }
+            }
+        }
+
+    private:
+        struct FieldBase
+        {
+            std::string column;
+
+            FieldBase(const char* name)
+                : column(name)
+            {
+            }
+
+            virtual ~FieldBase()
+            {
+            }
+
+            virtual void read(const Cursor& cursor, int index, T& object) const = 0;
+        };
+
+        template<typename M>
+        struct Field : public FieldBase
+        {
+            M T::*member;
+
+            Field(const char* name, M T::*m)
+                : FieldBase(name)
+                , member(m)
+            {
+            }
+
+            virtual void read(const Cursor& cursor, int index, T& object) const
+            {
+                DBColumnReader<M>::read(cursor, index, object.*member);
+            }
+        };
+
+        std::vector<FieldBase*> m_fields;
+
+        explicit DBMapper(bool)
+            : m_fields()
+        {
+            DBMapping<T>::map(*this);
+        }
+
+        DBMapper(const DBMapper&);
+        DBMapper& operator=(const DBMapper&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBMAPPING_H */
+/* EOF */
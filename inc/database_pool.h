@@ -0,0 +1,124 @@
+#ifndef DBPOOL_H
+#define DBPOOL_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "database.h"
+
+namespace sql
+{
+    struct DBLeaseStats
+    {
+        uint64_t leases;
+        uint64_t waits;       /*leases that found no free connection*/
+        uint64_t timeouts;
+        uint64_t totalWaitNs;
+        uint64_t maxWaitNs;
+    };
+
+    struct DBPoolStats
+    {
+        DBLeaseStats reader;
+        DBLeaseStats writer;
+    };
+
+    /**
+     * DatabasePool
+     *
+     * A set of connections to one database file in WAL mode: several read-only
+     * connections that can run concurrently and a single write connection.
+     * A connection is used by one thread at a time through a Lease, which hands
+     * it back to the pool when released or destroyed.
+     */
+    class DatabasePool
+    {
+    public:
+        class Lease
+        {
+        public:
+            Lease();
+            Lease(Lease&& x);
+            ~Lease();
+
+            Lease& operator=(Lease&& x);
+
+            database* operator->() const
+            {
+                return m_db;
+            }
+
+            database& operator*() const
+            {
+                return *m_db;
+            }
+
+            database* get() const
+            {
+                return m_db;
+            }
+
+            bool isValid() const
+            {
+                return (m_db != NULL);
+            }
+
+            void release();
+
+        private:
+            friend class DatabasePool;
+
+            Lease(DatabasePool* pool, database* db);
+
+            DatabasePool* m_pool;
+            database*     m_db;
+
+            Lease(const Lease&);
+            Lease& operator=(const Lease&);
+        };
+
+        DatabasePool(const std::string& path, int readers, const void* pKey = NULL, int nKey = 0);
+        virtual ~DatabasePool();
+
+        /*false when the file could not be opened or switched to WAL*/
+        bool isOpen() const;
+        int getReaderCount() const;
+
+        /*timeoutMs < 0 waits forever, an invalid lease is returned on timeout*/
+        Lease acquireReader(int timeoutMs = -1);
+        Lease acquireWriter(int timeoutMs = -1);
+
+        DBPoolStats getStats() const;
+        void resetStats();
+
+    private:
+        std::string m_path;
+
+        database*              m_writer;
+        std::vector<database*> m_readers;
+
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_readerAvailable;
+        std::condition_variable m_writerAvailable;
+        std::vector<database*>  m_freeReaders;
+        bool                    m_writerFree;
+
+        DBPoolStats m_stats;
+
+        void giveBack(database* db);
+
+        DatabasePool(const DatabasePool&);
+        DatabasePool& operator=(const DatabasePool&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBPOOL_H */
+/* EOF */
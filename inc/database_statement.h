@@ -0,0 +1,75 @@
+#ifndef DBSTATEMENT_H
+#define DBSTATEMENT_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace sql
+{
+    struct DBStatementCacheStats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t   size;
+        size_t   capacity;
+    };
+
+    /**
+     * DBStatementCache
+     *
+     * LRU cache of prepared statements keyed by SQL text, owned by one connection.
+     * A statement is checked out by acquire() and handed back by release(), which
+     * resets it and clears its bindings, so the same SQL may be in use more than once.
+     */
+    class DBStatementCache
+    {
+    public:
+        DBStatementCache(sqlite3* handle, size_t capacity);
+        ~DBStatementCache();
+
+        sqlite3_stmt* acquire(const std::string& sql, int* err = NULL);
+        void release(const std::string& sql, sqlite3_stmt* stmt);
+
+        void setCapacity(size_t capacity);
+        size_t getCapacity() const;
+        void clear();
+
+        DBStatementCacheStats getStats() const;
+        void resetStats();
+
+    private:
+        typedef std::pair<std::string, sqlite3_stmt*> Entry;
+        typedef std::list<Entry> EntryList;
+
+        sqlite3* m_handle;
+        size_t   m_capacity;
+
+        /*front is the most recently used entry*/
+        EntryList m_entries;
+        std::unordered_multimap<std::string, EntryList::iterator> m_index;
+
+        uint64_t m_hits;
+        uint64_t m_misses;
+        uint64_t m_evictions;
+
+        void evict(size_t capacity);
+
+        DBStatementCache(const DBStatementCache&);
+        DBStatementCache& operator=(const DBStatementCache&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBSTATEMENT_H */
+/* EOF */
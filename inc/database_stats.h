@@ -0,0 +1,175 @@
+#ifndef DBSTATS_H
+#define DBSTATS_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace sql
+{
+    /*one normalized statement, times in nanoseconds*/
+    struct DBStatementStats
+    {
+        std::string sql;
+        uint64_t count;
+        uint64_t totalNs;
+        uint64_t minNs;
+        uint64_t maxNs;
+        /*from a log-linear histogram, within 25% of the real value*/
+        uint64_t p50Ns;
+        uint64_t p99Ns;
+        uint64_t rowsReturned;
+        uint64_t rowsChanged;
+    };
+
+    /*one statement that took longer than the slow query threshold*/
+    struct DBSlowQuery
+    {
+        /*bound values inlined, or replaced by '?' when redacted*/
+        std::string sql;
+        uint64_t elapsedNs;
+        /*detail column of EXPLAIN QUERY PLAN, one line per row*/
+        std::vector<std::string> plan;
+        /*some table is read by a full SCAN without an index*/
+        bool fullScan;
+    };
+
+    typedef std::function<void(const DBSlowQuery&)> DBSlowQueryHandler;
+
+    /**
+     * DBSlowQueryLog
+     *
+     * Reports statements run by the wrapper that take longer than a threshold,
+     * together with their EXPLAIN QUERY PLAN. The plan is only prepared for
+     * statements that were slow, fast statements cost one clock read.
+     */
+    class DBSlowQueryLog
+    {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        DBSlowQueryLog();
+
+        /*-1 disables the log*/
+        void setThreshold(int thresholdMs);
+        bool isEnabled() const;
+        void setRedaction(bool redact);
+        /*default handler logs a warning through DBLog*/
+        void setHandler(const DBSlowQueryHandler& handler);
+
+        /*call before the statement is reset, the bound values are read from it*/
+        void check(sqlite3* handle, sqlite3_stmt* stmt, Clock::time_point start) const;
+
+        static bool explain(sqlite3* handle, const char* sql, std::vector<std::string>& plan);
+
+    private:
+        int64_t m_thresholdNs;
+        bool    m_redact;
+        DBSlowQueryHandler m_handler;
+
+        static void print(const DBSlowQuery& query);
+    };
+
+    /**
+     * DBQueryStats
+     *
+     * Per statement timings of one connection, collected through sqlite3_trace_v2.
+     * A statement is timed from its first step to its reset, and is accounted
+     * under its SQL with literals replaced by '?', so statements that only differ
+     * in inlined values share one entry. Counters are kept twice: since creation
+     * or reset(), and since the last interval() call.
+     */
+    class DBQueryStats
+    {
+    public:
+        DBQueryStats(sqlite3* handle);
+        ~DBQueryStats();
+
+        /*sorted by total time, most expensive first*/
+        std::vector<DBStatementStats> snapshot() const;
+        /*counters since the previous call, then starts a new interval*/
+        std::vector<DBStatementStats> interval();
+        void reset();
+        /*statements traced while paused are not counted, from the connection's thread*/
+        void pause(bool paused);
+
+        static std::string normalize(const char* sql);
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        enum { MaxTextCache = 1024 };
+
+        struct Totals
+        {
+            /*4 buckets per power of two, up to 2^40 ns*/
+            enum { BucketCount = 41 * 4 };
+
+            uint64_t count;
+            uint64_t totalNs;
+            uint64_t minNs;
+            uint64_t maxNs;
+            uint64_t rowsReturned;
+            uint64_t rowsChanged;
+            uint32_t buckets[BucketCount];
+
+            Totals();
+            void add(uint64_t ns, uint64_t rows, uint64_t changes);
+            uint64_t percentile(double q) const;
+        };
+
+        struct Entry
+        {
+            std::string sql;
+            Totals total;
+            Totals current;
+        };
+
+        struct Running
+        {
+            Clock::time_point start;
+            uint64_t rows;
+            int      changes;
+            Entry*   entry;
+        };
+
+        sqlite3* m_handle;
+        mutable std::mutex m_mutex;
+
+        std::list<Entry> m_entries;
+        std::unordered_map<std::string, Entry*> m_byNormalized;
+        /*raw SQL text seen before, skips normalizing it again*/
+        std::unordered_map<std::string, Entry*> m_byText;
+        /*only touched by the trace callbacks, which sqlite runs one at a time per
+          connection, so rows are counted without m_mutex*/
+        std::unordered_map<sqlite3_stmt*, Running> m_running;
+        bool m_paused;
+
+        static int trace(unsigned type, void* context, void* p, void* x);
+        void onStart(sqlite3_stmt* stmt);
+        void onRow(sqlite3_stmt* stmt);
+        void onEnd(sqlite3_stmt* stmt);
+
+        static void fill(const Entry& entry, const Totals& totals, DBStatementStats& stats);
+        std::vector<DBStatementStats> collect(bool current) const;
+
+        DBQueryStats(const DBQueryStats&);
+        DBQueryStats& operator=(const DBQueryStats&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBSTATS_H */
+/* EOF */
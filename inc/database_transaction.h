@@ -0,0 +1,53 @@
+#ifndef DBTRANSACTION_H
+#define DBTRANSACTION_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <string>
+
+namespace sql
+{
+    class database;
+
+    enum DBTransactionMode
+    {
+        DBTransaction_Deferred = 0,
+        DBTransaction_Immediate = 1,
+        DBTransaction_Exclusive = 2
+    };
+
+    /**
+     * Transaction
+     *
+     * Scoped transaction on a database. The outermost scope issues BEGIN, nested
+     * scopes use SAVEPOINT so they can be committed or rolled back on their own.
+     * Anything not committed is rolled back when the guard is destroyed. Scopes
+     * must end in the reverse order they were opened.
+     */
+    class Transaction
+    {
+    public:
+        Transaction(database& db, DBTransactionMode mode = DBTransaction_Deferred);
+        virtual ~Transaction();
+
+        int commit();
+        int rollback();
+
+        bool isActive() const;
+        bool isNested() const;
+
+    private:
+        database&   m_db;
+        std::string m_savepoint;
+        bool        m_active;
+
+        Transaction(const Transaction&);
+        Transaction& operator=(const Transaction&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBTRANSACTION_H */
+/* EOF */
@@ -0,0 +1,93 @@
+#ifndef DBWRITER_H
+#define DBWRITER_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "database.h"
+
+namespace sql
+{
+    struct DBWriteQueueStats
+    {
+        uint64_t operations;
+        uint64_t flushes;
+        uint64_t failedCommits;
+        uint64_t maxBatch;
+    };
+
+    /**
+     * WriteQueue
+     *
+     * Funnels writes from many threads into one connection. A single writer
+     * thread drains the queue and groups everything pending into one transaction
+     * per flush, so producers share the cost of the commit. Every operation runs
+     * in its own savepoint, a failing operation does not undo the others.
+     * Futures are fulfilled once the flush has been committed.
+     */
+    class WriteQueue
+    {
+    public:
+        /*an operation returns a negative value on failure, insert returns the rowid*/
+        typedef std::function<int64_t(database&)> Operation;
+
+        WriteQueue(database& db, int maxBatchSize = 256, int maxLatencyMs = 5);
+        virtual ~WriteQueue();
+
+        /*an operation that throws is rolled back, its future rethrows the exception*/
+        std::future<int64_t> enqueue(const Operation& op);
+
+        std::future<int64_t> insert(const std::string& table, const DBDataRow& values);
+        std::future<int64_t> update(const std::string& table, const DBDataRow& values,
+                                    const std::string& where, const std::vector<std::string>& whereArgs);
+        std::future<int64_t> remove(const std::string& table, const std::string& where,
+                                    const std::vector<std::string>& whereArgs);
+
+        /*commit everything queued so far and stop the writer thread*/
+        void stop();
+
+        DBWriteQueueStats getStats() const;
+
+    private:
+        struct Request
+        {
+            Operation         op;
+            std::promise<int64_t> result;
+            std::chrono::steady_clock::time_point queued;
+        };
+
+        database& m_db;
+        int       m_maxBatchSize;
+        int       m_maxLatencyMs;
+
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_pending;
+        std::deque<Request>     m_queue;
+        bool                    m_stopping;
+        std::thread             m_writer;
+
+        DBWriteQueueStats m_stats;
+
+        void run();
+        void flush(std::vector<Request>& batch);
+
+        WriteQueue(const WriteQueue&);
+        WriteQueue& operator=(const WriteQueue&);
+    };
+
+} /* namespace sql */
+
+#endif /* DBWRITER_H */
+/* EOF */
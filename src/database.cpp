@@ -1,87 +1,265 @@
+#include <ctype.h>
+#include <string.h>
 #include <iterator>
-#include <iostream>
+#include <thread>
 
 #include "database.h"
 #include "sqlite3.h"
 
+#define LOG_TAG "dbhelper"
+#include "database_log.h"
+
 namespace sql {
 
-database::database(const std::string &path, const void *pKey, int nKey)
+static const size_t DEFAULT_STATEMENT_CACHE_SIZE = 32;
+static const int DEFAULT_BATCH_SIZE = 1000;
+static const DBRetryPolicy DEFAULT_RETRY_POLICY = { 0, 1, 50 };
+/*virtual machine instructions between checks for cancel() and the deadline*/
+static const int PROGRESS_INTERVAL = 1000;
+
+// BEGIN/COMMIT/SAVEPOINT/RELEASE change no rows, ROLLBACK is seen by the rollback hook.
+static bool isTransactionControl(const std::string &sql)
+{
+    static const char* const keywords[] = { "BEGIN", "COMMIT", "END", "SAVEPOINT", "RELEASE" };
+
+    size_t start = sql.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return true;
+    }
+
+    // a second statement could write behind the first keyword.
+    size_t end = sql.find_last_not_of(" \t\r\n;");
+    if (sql.find(';', start) < end) {
+        return false;
+    }
+
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        size_t length = strlen(keywords[i]);
+        if (sqlite3_strnicmp(sql.c_str() + start, keywords[i], length) == 0
+            && (start + length == sql.size() || !isalnum(static_cast<unsigned char>(sql[start + length])))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// words of a single statement, lower case and unquoted, empty for several statements.
+static std::vector<std::string> statementWords(const std::string &sql)
+{
+    std::vector<std::string> words;
+
+    size_t end = sql.find_last_not_of(" \t\r\n;");
+    if (end == std::string::npos || sql.find(';') < end) {
+        return words;
+    }
+
+    std::string word;
+    for (size_t i = 0; i <= end; i++) {
+        unsigned char c = sql[i];
+        if (isspace(c)) {
+            if (!word.empty()) {
+                words.push_back(word);
+                word.clear();
+            }
+        }
+        else if (c != '"' && c != '\'' && c != '`' && c != '[' && c != ']') {
+            word.push_back(tolower(c));
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+
+    return words;
+}
+
+static DBChangeOp changeOp(int type)
+{
+    switch (type) {
+    case SQLITE_INSERT:
+        return DBChange_Insert;
+    case SQLITE_DELETE:
+        return DBChange_Delete;
+    default:
+        return DBChange_Update;
+    }
+}
+
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+static std::shared_ptr<const DBDataRow> preupdateValues(sqlite3 *handle, bool old)
+{
+    int count = sqlite3_preupdate_count(handle);
+    std::shared_ptr<DBDataRow> row(new DBDataRow(count));
+
+    for (int i = 0; i < count; i++) {
+        sqlite3_value *value = NULL;
+        int err = old ? sqlite3_preupdate_old(handle, i, &value) : sqlite3_preupdate_new(handle, i, &value);
+        if (err != SQLITE_OK || value == NULL) {
+            row->putNull(i);
+            continue;
+        }
+
+        switch (sqlite3_value_type(value)) {
+        case SQLITE_INTEGER:
+            row->putLong(i, sqlite3_value_int64(value));
+            break;
+        case SQLITE_FLOAT:
+            row->putDouble(i, sqlite3_value_double(value));
+            break;
+        case SQLITE_TEXT:
+        {
+            const char *text = reinterpret_cast<const char*>(sqlite3_value_text(value));
+            row->putString(i, text, sqlite3_value_bytes(value) + 1);
+            break;
+        }
+        case SQLITE_BLOB:
+            row->putBlob(i, sqlite3_value_blob(value), sqlite3_value_bytes(value));
+            break;
+        default:
+            row->putNull(i);
+            break;
+        }
+    }
+
+    return row;
+}
+#endif
+
+static bool isBusy(int err)
+{
+    err &= 0xff;
+    return (err == SQLITE_BUSY || err == SQLITE_LOCKED);
+}
+
+database::database(const std::string &path, const void *pKey, int nKey, bool readOnly)
     : m_path(path)
+    , m_dbHandle(NULL)
+    , m_statements(NULL)
+    , m_queryStats(NULL)
+    , m_slowQueries()
+    , m_resultCache(NULL)
+    , m_watchOtherConnections(false)
+    , m_dataVersion(-1)
+    , m_changes(NULL)
+    , m_changeValues(false)
+    , m_batchSize(DEFAULT_BATCH_SIZE)
+    , m_transactionDepth(0)
+    , m_lastError(DB_OK)
+    , m_busyTimeoutMs(0)
+    , m_retryPolicy(DEFAULT_RETRY_POLICY)
+    , m_immediateWrites(false)
+    , m_busyStats()
+    , m_busyStart()
+    , m_random(std::random_device()())
+    , m_queryTimeoutMs(0)
+    , m_deadline()
+    , m_timedOut(false)
+    , m_cancelled(false)
 {
     // create database
     sqlite3* handle = NULL;
 
-    int err = sqlite3_open_v2(path.c_str(), &handle,
-                              SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
-                              NULL);
+    int flags = readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    int err = sqlite3_open_v2(path.c_str(), &handle, flags, NULL);
 
     if (err != SQLITE_OK) {
-        // error!
+        LOGE("open %s failed: %s", path.c_str(), sqlite3_errmsg(handle));
+        sqlite3_close(handle);
     }
     else {
         if (pKey && (nKey > 0)) {
             err = sqlite3_key(handle, pKey, nKey);
-            std::cout << "sqlite key error " << err << "\n";
             if (err != SQLITE_OK) {
+                LOGE("sqlite3_key on %s failed: %d", path.c_str(), err);
                 sqlite3_close(handle);
                 return ;
             }
         }
 
         m_dbHandle = handle;
+        m_statements = new DBStatementCache(handle, DEFAULT_STATEMENT_CACHE_SIZE);
+        sqlite3_progress_handler(handle, PROGRESS_INTERVAL, progressHandler, this);
     }
 }
 
 database::~database()
 {
-    if (m_dbHandle) {
-        int err = sqlite3_close(m_dbHandle);
-        if (err != SQLITE_OK) {
-            // error
-        }
-    }
+    close();
 }
 
 int database::exec(const std::string &sql)
 {
-    // why not exec directly?
-    int err = sqlite3_exec(m_dbHandle, sql.c_str(), NULL, NULL, NULL);
+    startCall();
+    int err = execute(sql);
+    finishCall(err);
 
-    if (err != SQLITE_OK) {
-        // error?
+    // the tables touched by free form SQL are unknown, DDL included.
+    if (m_resultCache && !isTransactionControl(sql)) {
+        m_resultCache->clear();
     }
 
     return err;
 }
 
-DBDataTable *database::rawQuery(const std::string &sql, const std::vector<std::string> &args)
+int database::execute(const std::string &sql)
 {
-    sqlite3_stmt *stmt = NULL;
+    int err = m_changes ? executeTracked(sql) : sqlite3_exec(m_dbHandle, sql.c_str(), NULL, NULL, NULL);
 
-    int err = sqlite3_prepare_v2(m_dbHandle, sql.data(), sql.length(), &stmt, NULL);
     if (err != SQLITE_OK) {
-        // error?
+        LOGE("exec failed: %s: %s", sqlite3_errmsg(m_dbHandle), sql.c_str());
     }
 
-    for (int i = 0; i < args.size(); i++) {
-        sqlite3_bind_text(stmt, i+1, args[i].data(), args[i].length(), SQLITE_TRANSIENT);
+    return err;
+}
+
+std::unique_ptr<DBDataTable> database::rawQuery(const std::string &sql, const std::vector<std::string> &args)
+{
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
+        return NULL;
     }
 
-    // replace to shared pointer? how to check result?
-    DBDataTable* dataTable = new DBDataTable(0);
+    // args outlive the call, no need for sqlite to copy them.
+    if (bindStrings(stmt, 1, false, args) != SQLITE_OK) {
+        discard(sql, stmt);
+        return NULL;
+    }
 
-    int result = fillTable(stmt, dataTable);
-    if (result <= 0) {
-        //
-        delete dataTable;
+    return fetchTable(sql, stmt);
+}
+
+int database::rawQuery(DBDataTable &result, const std::string &sql, const std::vector<std::string> &args)
+{
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
+        return -1;
+    }
+
+    if (bindStrings(stmt, 1, false, args) != SQLITE_OK) {
+        discard(sql, stmt);
+        return -1;
+    }
+
+    return fetchInto(sql, stmt, result);
+}
+
+std::unique_ptr<DBColumnTable> database::rawQueryColumns(const std::string &sql, const std::vector<std::string> &args)
+{
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
         return NULL;
     }
 
-    return dataTable;
+    if (bindStrings(stmt, 1, false, args) != SQLITE_OK) {
+        discard(sql, stmt);
+        return NULL;
+    }
+
+    return fetchColumns(sql, stmt);
 }
 
-DBDataTable *database::query(const std::string &table, const std::vector<std::string> &columns,
+std::unique_ptr<DBDataTable> database::query(const std::string &table, const std::vector<std::string> &columns,
                              const std::string &where, const std::vector<std::string> &whereArgs,
                              const std::string &orderBy)
 {
@@ -92,11 +270,127 @@ DBDataTable *database::query(const std::string &table, const std::vector<std::st
     return query(false, table, columns, where, whereArgs, groupBy, having, orderBy, limit);
 }
 
-DBDataTable *database::query(bool distinct, const std::string &table,
+std::shared_ptr<const DBDataTable> database::rawQueryCached(const std::string &sql, const std::vector<std::string> &args)
+{
+    if (m_resultCache == NULL) {
+        return std::shared_ptr<const DBDataTable>(rawQuery(sql, args));
+    }
+
+    if (m_watchOtherConnections) {
+        int64_t version = dataVersion();
+        if (version != m_dataVersion) {
+            m_resultCache->clear();
+            m_dataVersion = version;
+        }
+    }
+
+    std::string key = DBResultCache::makeKey(sql, args);
+    std::shared_ptr<const DBDataTable> table;
+    if (m_resultCache->lookup(key, table)) {
+        m_lastError = DB_OK;
+        return table;
+    }
+
+    // SQL that cannot be prepared fails below as well.
+    std::vector<std::string> reads;
+    if (!m_resultCache->getReadTables(m_dbHandle, sql, reads)) {
+        return std::shared_ptr<const DBDataTable>(rawQuery(sql, args));
+    }
+
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
+        return NULL;
+    }
+
+    if (bindStrings(stmt, 1, false, args) != SQLITE_OK) {
+        discard(sql, stmt);
+        return NULL;
+    }
+
+    // a write must run again on every call, its result is not kept.
+    bool readonly = (sqlite3_stmt_readonly(stmt) != 0);
+    std::unique_ptr<DBDataTable> result(new DBDataTable(0));
+    int rows = fetchInto(sql, stmt, *result);
+    if (rows < 0) {
+        return NULL;
+    }
+
+    // empty results are cached too, as NULL.
+    if (rows > 0) {
+        table.reset(result.release());
+    }
+    if (readonly) {
+        m_resultCache->insert(key, table, reads);
+    }
+
+    return table;
+}
+
+std::shared_ptr<const DBDataTable> database::queryCached(const std::string &table, const std::vector<std::string> &columns,
+                                                         const std::string &where, const std::vector<std::string> &whereArgs,
+                                                         const std::string &orderBy)
+{
+    std::string sql = querySql(false, table, columns, where, "", "", orderBy, "");
+
+    return rawQueryCached(sql, whereArgs);
+}
+
+std::unique_ptr<DBDataTable> database::query(bool distinct, const std::string &table,
                              const std::vector<std::string> &columns,
                              const std::string &where, const std::vector<std::string> &whereArgs,
                              const std::string &groupBy, const std::string &having,
                              const std::string &orderBy, const std::string &limit)
+{
+    std::string sql = querySql(distinct, table, columns, where, groupBy, having, orderBy, limit);
+
+    return rawQuery(sql, whereArgs);
+}
+
+std::unique_ptr<Cursor> database::rawQueryCursor(const std::string &sql, const std::vector<std::string> &args)
+{
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
+        return NULL;
+    }
+
+    // the cursor outlives args, let sqlite keep its own copy.
+    if (bindStrings(stmt, 1, true, args) != SQLITE_OK) {
+        discard(sql, stmt);
+        return NULL;
+    }
+
+    // the deadline covers the call, rows stepped later are only stopped by cancel().
+    finishCall(SQLITE_OK);
+
+    return std::unique_ptr<Cursor>(new Cursor(this, m_statements, sql, stmt));
+}
+
+std::unique_ptr<Cursor> database::queryCursor(const std::string &table, const std::vector<std::string> &columns,
+                              const std::string &where, const std::vector<std::string> &whereArgs,
+                              const std::string &orderBy)
+{
+    std::string groupBy;
+    std::string having;
+    std::string limit;
+
+    return queryCursor(false, table, columns, where, whereArgs, groupBy, having, orderBy, limit);
+}
+
+std::unique_ptr<Cursor> database::queryCursor(bool distinct, const std::string &table,
+                              const std::vector<std::string> &columns,
+                              const std::string &where, const std::vector<std::string> &whereArgs,
+                              const std::string &groupBy, const std::string &having,
+                              const std::string &orderBy, const std::string &limit)
+{
+    std::string sql = querySql(distinct, table, columns, where, groupBy, having, orderBy, limit);
+
+    return rawQueryCursor(sql, whereArgs);
+}
+
+std::string database::querySql(bool distinct, const std::string &table,
+                               const std::vector<std::string> &columns, const std::string &where,
+                               const std::string &groupBy, const std::string &having,
+                               const std::string &orderBy, const std::string &limit)
 {
     std::string sql("SELECT ");
     if (distinct) {
@@ -146,204 +440,1245 @@ DBDataTable *database::query(bool distinct, const std::string &table,
         sql.append(limit.data());
     }
 
-    return rawQuery(sql, whereArgs);
+    return sql;
 }
 
 // return the row id of inserted
-int database::insert(const std::string &table, const DBDataRow &values)
+int64_t database::insert(const std::string &table, const DBDataRow &values)
 {
-    std::string sql("INSERT");
-    sql.append(" INTO ");
-    sql.append(table.data());
-    sql.append("(");
-
-    //
-    int length = values.getColumnCount();
-    for (int i = 0; i < length; i++) {
-        if (i != 0) {
-            sql.append(", ");
-        }
-        sql.append(values.getColumnName(i));
-    }
-
-    sql.append(")");
-    sql.append(" VALUES (");
-    for (int i = 0; i < length; ++i) {
-        if (i > 0) {
-            sql.append(", ?");
-        }
-        else {
-            sql.append("?");
-        }
+    const DBDataSchema* schema = values.getSchema();
+    if (schema == NULL) {
+        // no column names given.
+        return -1;
     }
-    sql.append(")");
 
-    sqlite3_stmt *stmt = NULL;
+    std::string sql = insertSql(table, *schema);
 
-    int err = sqlite3_prepare_v2(m_dbHandle, sql.data(), sql.length(), &stmt, NULL);
-    if (err != SQLITE_OK) {
-        // error?
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
         return -1;
     }
 
-    for (int i = 0; i < length; i++) {
-        DBDataType type = values.type(i);
-        int err = 0;
-        switch (type) {
-        case DBDataType_Integer:
-            err = sqlite3_bind_int64(stmt, i+1, values.getLong(i));
-            break;
-        case DBDataType_Float:
-            err = sqlite3_bind_double(stmt, i+1, values.getDouble(i));
-            break;
-        case DBDataType_String:
-        {
-            size_t len = 0;
-            const char* sql = values.getString(i, len);
-            err = sqlite3_bind_text(stmt, i+1, sql, len, SQLITE_TRANSIENT);
-            break;
-        }
-        case DBDataType_Blob:
-        {
-            size_t len = 0;
-            const void* blob = values.getBlob(i, len);
-            err = sqlite3_bind_blob(stmt, i+1, blob, len, SQLITE_TRANSIENT);
-            break;
-        }
-        case DBDataType_Null:
-        default:
-            break;
-        }
+    if (bindRow(stmt, values, 0) != SQLITE_OK) {
+        discard(sql, stmt);
+        return -1;
     }
 
+    DBSlowQueryLog::Clock::time_point start = slowQueryStart();
+
+    tableChanged(table);
+
     // step!
-    err = sqlite3_step(stmt);
+    int err = stepWrite(stmt);
+    checkSlowQuery(stmt, start);
+    m_statements->release(sql, stmt);
+    finishCall(err);
     if (err != SQLITE_DONE) {
-        // error
+        LOGE("insert into %s failed: %s", table.c_str(), sqlite3_errmsg(m_dbHandle));
         return -1;
     }
 
     return sqlite3_last_insert_rowid(m_dbHandle);
 }
 
-// return number changes
-int database::update(const std::string &table, const DBDataRow &values, const std::string &where, const std::vector<std::string> &whereArgs)
+// return the number of inserted rows
+int database::insertMany(const std::string &table, const DBDataTable &values, std::vector<int> *failedRows)
 {
-    std::string sql("UPDATE ");
-    sql.append(table.data());
-    sql.append(" SET ");
-
-    //
-    int length = values.getColumnCount();
-    for (int i = 0; i < length; i++) {
-        if (i != 0) {
-            sql.append(", ");
-        }
-        sql.append(values.getColumnName(i));
-        sql.append("=?");
+    int rowCount = values.getRowCount();
+    if (rowCount <= 0) {
+        return 0;
     }
 
-    if (where.length() > 0) {
-        sql.append(" WHERE ");
-        sql.append(where.data());
-    }
+    std::string sql = insertSql(table, *values.getSchema());
 
-    sqlite3_stmt *stmt = NULL;
-
-    int err = sqlite3_prepare_v2(m_dbHandle, sql.data(), sql.length(), &stmt, NULL);
-    if (err != SQLITE_OK) {
-        // error?
+    bool ownTransaction = false;
+    sqlite3_stmt *stmt = beginBatch(sql, ownTransaction);
+    if (stmt == NULL) {
         return -1;
     }
 
-    for (int i = 0; i < length; i++) {
-        DBDataType type = values.type(i);
-        int err = 0;
-        switch (type) {
-        case DBDataType_Integer:
-            err = sqlite3_bind_int64(stmt, i+1, values.getLong(i));
-            break;
-        case DBDataType_Float:
-            err = sqlite3_bind_double(stmt, i+1, values.getDouble(i));
-            break;
-        case DBDataType_String:
-        {
-            size_t len = 0;
-            const char* sql = values.getString(i, len);
-            err = sqlite3_bind_text(stmt, i+1, sql, len, SQLITE_TRANSIENT);
-            break;
+    int inserted = 0;
+    bool failed = false;
+    for (int i = 0; i < rowCount; i++) {
+        const DBDataRow* row = values.getRow(i);
+        if (row != NULL && insertRow(stmt, *row)) {
+            inserted++;
         }
-        case DBDataType_Blob:
-        {
-            size_t len = 0;
-            const void* blob = values.getBlob(i, len);
-            err = sqlite3_bind_blob(stmt, i+1, blob, len, SQLITE_TRANSIENT);
-            break;
+        else {
+            if (failedRows) {
+                failedRows->push_back(i);
+            }
+            if (m_lastError == DB_TIMEOUT || m_lastError == DB_CANCELLED) {
+                break;
+            }
         }
-        case DBDataType_Null:
-        default:
+
+        if (ownTransaction && (i + 1) % m_batchSize == 0 && !commitBatch()) {
+            failed = true;
             break;
         }
     }
 
-    for (int i = 0; i < whereArgs.size(); i++) {
-        sqlite3_bind_text(stmt, i+1+length, whereArgs[i].data(), whereArgs[i].length(), SQLITE_TRANSIENT);
-    }
+    tableChanged(table);
 
-    err = sqlite3_step(stmt);
-    if (err != SQLITE_DONE) {
+    if (!endBatch(sql, stmt, ownTransaction) || failed) {
         return -1;
     }
 
-    return sqlite3_changes(m_dbHandle);
+    return inserted;
 }
 
-int database::remove(const std::string &table, const std::string &where,
-                     const std::vector<std::string> &whereArgs)
+// return number changes
+int database::update(const std::string &table, const DBDataRow &values, const std::string &where, const std::vector<std::string> &whereArgs)
 {
-    std::string sql("DELETE FROM ");
-    sql.append(table.data());
-    if (0 == where.length()) {
-        sql.append("");
-    }
-    else {
-        sql.append(" WHERE ");
-        sql.append(where.data());
-    }
-
-    sqlite3_stmt *stmt = NULL;
+    std::string sql = updateSql(table, values, where);
 
-    int err = sqlite3_prepare_v2(m_dbHandle, sql.data(), sql.length(), &stmt, NULL);
-    if (err != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
         return -1;
     }
 
-    for (int i = 0; i < whereArgs.size(); i++) {
-        sqlite3_bind_text(stmt, i+1, whereArgs[i].data(), whereArgs[i].length(), SQLITE_TRANSIENT);
-    }
-
-    err = sqlite3_step(stmt);
-    if (err != SQLITE_DONE) {
+    if (bindRow(stmt, values, 0) != SQLITE_OK
+        || bindStrings(stmt, values.getColumnCount() + 1, false, whereArgs) != SQLITE_OK) {
+        discard(sql, stmt);
         return -1;
     }
 
-    return sqlite3_changes(m_dbHandle);
-}
+    tableChanged(table);
 
-void database::close()
-{
-    sqlite3_close(m_dbHandle);
+    return stepChanges(sql, stmt);
 }
 
-bool database::isOpen()
+int database::remove(const std::string &table, const std::string &where,
+                     const std::vector<std::string> &whereArgs)
 {
-    return (m_dbHandle != NULL);
+    std::string sql = removeSql(table, where);
+
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
+        return -1;
+    }
+
+    if (bindStrings(stmt, 1, false, whereArgs) != SQLITE_OK) {
+        discard(sql, stmt);
+        return -1;
+    }
+
+    tableChanged(table);
+
+    return stepChanges(sql, stmt);
+}
+
+void database::close()
+{
+    if (m_resultCache || m_changes) {
+        delete m_resultCache;
+        m_resultCache = NULL;
+        // closes the feeds, their consumers see isClosed().
+        delete m_changes;
+        m_changes = NULL;
+        installHooks();
+    }
+
+    if (m_queryStats) {
+        delete m_queryStats;
+        m_queryStats = NULL;
+    }
+
+    if (m_statements) {
+        // statements must be finalized before the handle can be closed.
+        delete m_statements;
+        m_statements = NULL;
+    }
+
+    if (m_dbHandle) {
+        int err = sqlite3_close(m_dbHandle);
+        if (err != SQLITE_OK) {
+            LOGE("close %s failed: %d", m_path.c_str(), err);
+        }
+        m_dbHandle = NULL;
+    }
+}
+
+bool database::isOpen()
+{
+    return (m_dbHandle != NULL);
+}
+
+bool database::isReadOnly()
+{
+    if (m_dbHandle == NULL) {
+        return false;
+    }
+
+    return (sqlite3_db_readonly(m_dbHandle, "main") == 1);
+}
+
+std::string database::getPath()
+{
+    return m_path;
+}
+
+void database::setBatchSize(int rows)
+{
+    m_batchSize = rows > 0 ? rows : 1;
+}
+
+std::string database::insertSql(const std::string &table, const DBDataSchema &schema)
+{
+    std::string sql("INSERT");
+    sql.append(" INTO ");
+    sql.append(table.data());
+    sql.append("(");
+    sql.append(schema.getColumnList());
+    sql.append(")");
+
+    sql.append(" VALUES (");
+    int length = schema.getColumnCount();
+    for (int i = 0; i < length; ++i) {
+        if (i > 0) {
+            sql.append(", ?");
+        }
+        else {
+            sql.append("?");
+        }
+    }
+    sql.append(")");
+
+    return sql;
+}
+
+std::string database::updateSql(const std::string &table, const DBDataRow &values, const std::string &where)
+{
+    std::string sql("UPDATE ");
+    sql.append(table.data());
+    sql.append(" SET ");
+
+    //
+    int length = values.getColumnCount();
+    for (int i = 0; i < length; i++) {
+        if (i != 0) {
+            sql.append(", ");
+        }
+        sql.append(values.getColumnName(i));
+        sql.append("=?");
+    }
+
+    if (where.length() > 0) {
+        sql.append(" WHERE ");
+        sql.append(where.data());
+    }
+
+    return sql;
+}
+
+std::string database::removeSql(const std::string &table, const std::string &where)
+{
+    std::string sql("DELETE FROM ");
+    sql.append(table.data());
+    if (where.length() > 0) {
+        sql.append(" WHERE ");
+        sql.append(where.data());
+    }
+
+    return sql;
+}
+
+std::unique_ptr<DBDataTable> database::fetchTable(const std::string &sql, sqlite3_stmt *stmt)
+{
+    DBSlowQueryLog::Clock::time_point start = slowQueryStart();
+    std::unique_ptr<DBDataTable> dataTable;
+
+    // rows read before a failure are dropped, a retry starts from an empty table.
+    int result = -1;
+    size_t mark = changeMark();
+    for (int attempt = 0; result < 0; attempt++) {
+        dataTable.reset(new DBDataTable(0));
+        result = fillTable(stmt, dataTable.get());
+        if (result < 0) {
+            // the failed statement was rolled back, a write in it as well.
+            discardChanges(mark);
+            if (!retryBusy(stmt, sqlite3_errcode(m_dbHandle), attempt)) {
+                break;
+            }
+        }
+    }
+    queryWrote(stmt);
+    finishCall(result < 0 ? sqlite3_errcode(m_dbHandle) : SQLITE_OK);
+    checkSlowQuery(stmt, start);
+    m_statements->release(sql, stmt);
+    if (result <= 0) {
+        return NULL;
+    }
+
+    return dataTable;
+}
+
+int database::fetchInto(const std::string &sql, sqlite3_stmt *stmt, DBDataTable &result)
+{
+    DBSlowQueryLog::Clock::time_point start = slowQueryStart();
+
+    // the arena keeps its chunks across reset(), so refills mostly avoid malloc.
+    int rows = -1;
+    size_t mark = changeMark();
+    for (int attempt = 0; rows < 0; attempt++) {
+        result.reset();
+        rows = fillTable(stmt, &result);
+        if (rows < 0) {
+            discardChanges(mark);
+            if (!retryBusy(stmt, sqlite3_errcode(m_dbHandle), attempt)) {
+                break;
+            }
+        }
+    }
+    queryWrote(stmt);
+    finishCall(rows < 0 ? sqlite3_errcode(m_dbHandle) : SQLITE_OK);
+    if (rows < 0) {
+        result.reset();
+    }
+    checkSlowQuery(stmt, start);
+    m_statements->release(sql, stmt);
+
+    return rows;
+}
+
+std::unique_ptr<DBColumnTable> database::fetchColumns(const std::string &sql, sqlite3_stmt *stmt)
+{
+    DBSlowQueryLog::Clock::time_point start = slowQueryStart();
+    std::unique_ptr<DBColumnTable> columnTable;
+
+    int result = -1;
+    size_t mark = changeMark();
+    for (int attempt = 0; result < 0; attempt++) {
+        columnTable.reset(new DBColumnTable(sqlite3_column_count(stmt)));
+        result = fillTable(stmt, columnTable.get());
+        if (result < 0) {
+            discardChanges(mark);
+            if (!retryBusy(stmt, sqlite3_errcode(m_dbHandle), attempt)) {
+                break;
+            }
+        }
+    }
+    queryWrote(stmt);
+    finishCall(result < 0 ? sqlite3_errcode(m_dbHandle) : SQLITE_OK);
+    checkSlowQuery(stmt, start);
+    m_statements->release(sql, stmt);
+    if (result < 0) {
+        return NULL;
+    }
+
+    return columnTable;
+}
+
+int database::stepChanges(const std::string &sql, sqlite3_stmt *stmt)
+{
+    DBSlowQueryLog::Clock::time_point start = slowQueryStart();
+
+    int err = stepWrite(stmt);
+    checkSlowQuery(stmt, start);
+    m_statements->release(sql, stmt);
+    finishCall(err);
+    if (err != SQLITE_DONE) {
+        LOGE("statement failed: %s: %s", sqlite3_errmsg(m_dbHandle), sql.c_str());
+        return -1;
+    }
+
+    return sqlite3_changes(m_dbHandle);
+}
+
+DBSlowQueryLog::Clock::time_point database::slowQueryStart() const
+{
+    if (m_slowQueries.isEnabled()) {
+        return DBSlowQueryLog::Clock::now();
+    }
+
+    return DBSlowQueryLog::Clock::time_point();
+}
+
+// a DELETE without WHERE is not reported row by row, and the tables a free form write touches are unknown.
+void database::queryWrote(sqlite3_stmt *stmt)
+{
+    if (m_resultCache && !sqlite3_stmt_readonly(stmt)) {
+        m_resultCache->clear();
+    }
+}
+
+void database::cursorStepped(sqlite3_stmt *stmt, int err, size_t mark)
+{
+    queryWrote(stmt);
+
+    if (err != SQLITE_ROW && err != SQLITE_DONE) {
+        discardChanges(mark);
+    }
+    publishChanges();
+}
+
+// resetting an unfinished write completes it.
+void database::cursorClosed()
+{
+    publishChanges();
+}
+
+void database::checkSlowQuery(sqlite3_stmt *stmt, DBSlowQueryLog::Clock::time_point start)
+{
+    if (!m_slowQueries.isEnabled()) {
+        return;
+    }
+
+    // the EXPLAIN QUERY PLAN of a slow statement is not one of the caller's statements.
+    if (m_queryStats) {
+        m_queryStats->pause(true);
+    }
+    m_slowQueries.check(m_dbHandle, stmt, start);
+    if (m_queryStats) {
+        m_queryStats->pause(false);
+    }
+}
+
+int database::stepWrite(sqlite3_stmt *stmt)
+{
+    // inside a transaction the caller owns the locks, only a plain write is wrapped.
+    bool ownTransaction = m_immediateWrites && sqlite3_get_autocommit(m_dbHandle);
+
+    for (int attempt = 0; ; attempt++) {
+        int err = SQLITE_OK;
+        if (ownTransaction) {
+            err = sqlite3_exec(m_dbHandle, "BEGIN IMMEDIATE", NULL, NULL, NULL);
+        }
+
+        if (err == SQLITE_OK) {
+            size_t mark = changeMark();
+            err = sqlite3_step(stmt);
+            if (err != SQLITE_DONE) {
+                discardChanges(mark);
+            }
+            if (ownTransaction && err == SQLITE_DONE) {
+                err = sqlite3_exec(m_dbHandle, "COMMIT", NULL, NULL, NULL);
+                if (err == SQLITE_OK) {
+                    err = SQLITE_DONE;
+                }
+            }
+            if (ownTransaction && err != SQLITE_DONE) {
+                sqlite3_reset(stmt);
+                sqlite3_exec(m_dbHandle, "ROLLBACK", NULL, NULL, NULL);
+            }
+        }
+
+        if (err == SQLITE_DONE || !retryBusy(stmt, err, attempt)) {
+            return err;
+        }
+    }
+}
+
+// values are stepped before the call returns, so they are bound without a copy.
+int database::bindRow(sqlite3_stmt *stmt, const DBDataRow &values, int offset)
+{
+    int length = values.getColumnCount();
+    for (int i = 0; i < length; i++) {
+        DBDataType type = values.type(i);
+        int err = SQLITE_OK;
+        switch (type) {
+        case DBDataType_Integer:
+            err = sqlite3_bind_int64(stmt, i+1+offset, values.getLong(i));
+            break;
+        case DBDataType_Float:
+            err = sqlite3_bind_double(stmt, i+1+offset, values.getDouble(i));
+            break;
+        case DBDataType_String:
+        {
+            size_t len = 0;
+            const char* sql = values.getString(i, len);
+            err = sqlite3_bind_text(stmt, i+1+offset, sql, len, SQLITE_STATIC);
+            break;
+        }
+        case DBDataType_Blob:
+        {
+            size_t len = 0;
+            const void* blob = values.getBlob(i, len);
+            err = sqlite3_bind_blob(stmt, i+1+offset, blob, len, SQLITE_STATIC);
+            break;
+        }
+        case DBDataType_Null:
+        default:
+            err = sqlite3_bind_null(stmt, i+1+offset);
+            break;
+        }
+
+        if (err != SQLITE_OK) {
+            return err;
+        }
+    }
+
+    return SQLITE_OK;
+}
+
+sqlite3_stmt *database::beginBatch(const std::string &sql, bool &ownTransaction)
+{
+    sqlite3_stmt *stmt = prepare(sql);
+    if (stmt == NULL) {
+        return NULL;
+    }
+
+    // join the caller's transaction if there is one.
+    ownTransaction = false;
+    if (sqlite3_get_autocommit(m_dbHandle)) {
+        int err = execute(m_immediateWrites ? "BEGIN IMMEDIATE" : "BEGIN");
+        if (err != SQLITE_OK) {
+            m_statements->release(sql, stmt);
+            finishCall(err);
+            return NULL;
+        }
+        ownTransaction = true;
+    }
+    setStatus(SQLITE_OK);
+
+    return stmt;
+}
+
+bool database::insertRow(sqlite3_stmt *stmt, const DBDataRow &values)
+{
+    size_t mark = changeMark();
+    int err = bindRow(stmt, values, 0);
+    if (err == SQLITE_OK) {
+        err = sqlite3_step(stmt);
+    }
+    if (err != SQLITE_DONE) {
+        discardChanges(mark);
+    }
+
+    // a failed row only aborts its own statement, not the batch.
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    if (err != SQLITE_DONE) {
+        setStatus(err);
+        if (isBusy(err)) {
+            m_busyStats.busy++;
+            m_busyStats.failures++;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool database::commitBatch()
+{
+    int err = execute("COMMIT");
+    if (err == SQLITE_OK) {
+        err = execute(m_immediateWrites ? "BEGIN IMMEDIATE" : "BEGIN");
+    }
+
+    // the failed batch is rolled back and the insert stops, earlier batches stay committed.
+    if (err != SQLITE_OK) {
+        if (!sqlite3_get_autocommit(m_dbHandle)) {
+            sqlite3_exec(m_dbHandle, "ROLLBACK", NULL, NULL, NULL);
+        }
+        if (isBusy(err)) {
+            m_busyStats.busy++;
+            m_busyStats.failures++;
+        }
+        finishCall(err);
+        return false;
+    }
+
+    return true;
+}
+
+bool database::endBatch(const std::string &sql, sqlite3_stmt *stmt, bool ownTransaction)
+{
+    m_statements->release(sql, stmt);
+
+    // a stopped batch is rolled back, rows of earlier batches stay committed.
+    bool stopped = (m_lastError == DB_TIMEOUT || m_lastError == DB_CANCELLED);
+    if (ownTransaction && !sqlite3_get_autocommit(m_dbHandle)) {
+        int err = stopped ? SQLITE_INTERRUPT : execute("COMMIT");
+        if (err != SQLITE_OK) {
+            if (isBusy(err)) {
+                m_busyStats.busy++;
+                m_busyStats.failures++;
+            }
+            sqlite3_exec(m_dbHandle, "ROLLBACK", NULL, NULL, NULL);
+            finishCall(err);
+            return false;
+        }
+    }
+
+    // keeps the status of the last failed row.
+    m_deadline = std::chrono::steady_clock::time_point();
+
+    return !stopped;
+}
+
+void database::setStatementCacheSize(size_t capacity)
+{
+    if (m_statements) {
+        m_statements->setCapacity(capacity);
+    }
+}
+
+DBStatementCacheStats database::getStatementCacheStats() const
+{
+    if (m_statements) {
+        return m_statements->getStats();
+    }
+
+    DBStatementCacheStats stats = DBStatementCacheStats();
+    return stats;
+}
+
+void database::setStatsEnabled(bool enabled)
+{
+    if (enabled && m_queryStats == NULL && m_dbHandle) {
+        m_queryStats = new DBQueryStats(m_dbHandle);
+    }
+    else if (!enabled && m_queryStats) {
+        delete m_queryStats;
+        m_queryStats = NULL;
+    }
+}
+
+bool database::isStatsEnabled() const
+{
+    return (m_queryStats != NULL);
+}
+
+std::vector<DBStatementStats> database::stats() const
+{
+    if (m_queryStats) {
+        return m_queryStats->snapshot();
+    }
+
+    return std::vector<DBStatementStats>();
+}
+
+std::vector<DBStatementStats> database::intervalStats()
+{
+    if (m_queryStats) {
+        return m_queryStats->interval();
+    }
+
+    return std::vector<DBStatementStats>();
+}
+
+void database::resetStats()
+{
+    if (m_queryStats) {
+        m_queryStats->reset();
+    }
+}
+
+void database::setSlowQueryThreshold(int thresholdMs)
+{
+    m_slowQueries.setThreshold(thresholdMs);
+}
+
+void database::setSlowQueryRedaction(bool redact)
+{
+    m_slowQueries.setRedaction(redact);
+}
+
+void database::setSlowQueryHandler(const DBSlowQueryHandler& handler)
+{
+    m_slowQueries.setHandler(handler);
+}
+
+void database::setResultCacheSize(size_t budgetBytes, bool watchOtherConnections)
+{
+    if (budgetBytes == 0 || m_dbHandle == NULL) {
+        delete m_resultCache;
+        m_resultCache = NULL;
+    }
+    else if (m_resultCache == NULL) {
+        m_resultCache = new DBResultCache(budgetBytes);
+    }
+    else {
+        m_resultCache->setBudget(budgetBytes);
+    }
+
+    m_watchOtherConnections = watchOtherConnections;
+    m_dataVersion = -1;
+    installHooks();
+}
+
+DBResultCacheStats database::getResultCacheStats() const
+{
+    if (m_resultCache) {
+        return m_resultCache->getStats();
+    }
+
+    DBResultCacheStats stats = DBResultCacheStats();
+    return stats;
+}
+
+void database::clearResultCache()
+{
+    if (m_resultCache) {
+        m_resultCache->clear();
+    }
+}
+
+// one update and one rollback hook per connection, they fan out to whoever needs them.
+void database::installHooks()
+{
+    if (m_dbHandle == NULL) {
+        return;
+    }
+
+    bool changes = (m_changes != NULL);
+    bool needed = (m_resultCache != NULL || changes);
+    sqlite3_update_hook(m_dbHandle, needed ? updateHook : NULL, needed ? this : NULL);
+    sqlite3_rollback_hook(m_dbHandle, needed ? rollbackHook : NULL, needed ? this : NULL);
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+    sqlite3_preupdate_hook(m_dbHandle, changes ? preupdateHook : NULL, changes ? this : NULL);
+#endif
+}
+
+void database::updateHook(void *context, int type, const char *, const char *table, long long rowid)
+{
+    database *self = static_cast<database*>(context);
+    if (self->m_resultCache) {
+        self->m_resultCache->invalidate(table);
+    }
+
+#ifndef SQLITE_ENABLE_PREUPDATE_HOOK
+    if (self->m_changes) {
+        self->m_changes->record(changeOp(type), table, rowid,
+                                std::shared_ptr<const DBDataRow>(), std::shared_ptr<const DBDataRow>());
+    }
+#else
+    (void)type;
+    (void)rowid;
+#endif
+}
+
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+// also sees WITHOUT ROWID tables, their rowid is meaningless.
+void database::preupdateHook(void *context, sqlite3 *handle, int type, const char *,
+                             const char *table, long long oldRowid, long long newRowid)
+{
+    database *self = static_cast<database*>(context);
+    if (self->m_changes == NULL) {
+        return;
+    }
+
+    std::shared_ptr<const DBDataRow> oldValues;
+    std::shared_ptr<const DBDataRow> newValues;
+    if (self->m_changeValues) {
+        if (type != SQLITE_INSERT) {
+            oldValues = preupdateValues(handle, true);
+        }
+        if (type != SQLITE_DELETE) {
+            newValues = preupdateValues(handle, false);
+        }
+    }
+
+    self->m_changes->record(changeOp(type), table, (type == SQLITE_DELETE) ? oldRowid : newRowid,
+                            oldValues, newValues);
+}
+#endif
+
+void database::rollbackHook(void *context)
+{
+    // rows seen by queries inside the transaction are gone again.
+    database *self = static_cast<database*>(context);
+    if (self->m_resultCache) {
+        self->m_resultCache->clear();
+    }
+    if (self->m_changes) {
+        self->m_changes->rollback();
+    }
+}
+
+std::shared_ptr<DBChangeFeed> database::subscribeChanges(size_t capacity, const DBChangeFeed::Notify& notify)
+{
+    if (m_dbHandle == NULL) {
+        return std::shared_ptr<DBChangeFeed>();
+    }
+
+    if (m_changes == NULL) {
+        m_changes = new DBChangeLog();
+        installHooks();
+    }
+
+    return m_changes->subscribe(capacity, notify);
+}
+
+void database::unsubscribeChanges(const std::shared_ptr<DBChangeFeed>& feed)
+{
+    if (m_changes == NULL) {
+        return;
+    }
+
+    m_changes->unsubscribe(feed);
+
+    // changes of an open transaction are dropped with the log.
+    if (!m_changes->hasSubscribers()) {
+        delete m_changes;
+        m_changes = NULL;
+        installHooks();
+    }
+}
+
+bool database::setChangeValues(bool capture)
+{
+#ifdef SQLITE_ENABLE_PREUPDATE_HOOK
+    m_changeValues = capture;
+    return true;
+#else
+    m_changeValues = false;
+    return !capture;
+#endif
+}
+
+std::unique_ptr<DBBackup> database::backupTo(const std::string &path, int pagesPerStep, int sleepMs,
+                                             const void *pKey, int nKey, const DBBackup::ProgressHandler &handler)
+{
+    if (m_dbHandle == NULL) {
+        return NULL;
+    }
+
+    sqlite3 *handle = NULL;
+    int err = sqlite3_open_v2(path.c_str(), &handle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    if (err != SQLITE_OK) {
+        LOGE("open %s failed: %s", path.c_str(), sqlite3_errmsg(handle));
+        sqlite3_close(handle);
+        m_lastError = DB_ERROR;
+        return NULL;
+    }
+
+    if (pKey && (nKey > 0)) {
+        err = sqlite3_key(handle, pKey, nKey);
+        if (err != SQLITE_OK) {
+            LOGE("sqlite3_key on %s failed: %d", path.c_str(), err);
+            sqlite3_close(handle);
+            m_lastError = DB_ERROR;
+            return NULL;
+        }
+    }
+
+    return startBackup(handle, true, pagesPerStep, sleepMs, handler);
+}
+
+std::unique_ptr<DBBackup> database::backupTo(database &dest, int pagesPerStep, int sleepMs,
+                                             const DBBackup::ProgressHandler &handler)
+{
+    if (m_dbHandle == NULL || dest.m_dbHandle == NULL || dest.m_dbHandle == m_dbHandle) {
+        return NULL;
+    }
+
+    // results cached on dest would outlive its content.
+    dest.clearResultCache();
+
+    return startBackup(dest.m_dbHandle, false, pagesPerStep, sleepMs, handler);
+}
+
+std::unique_ptr<DBBackup> database::startBackup(sqlite3 *destination, bool owned, int pagesPerStep, int sleepMs,
+                                                const DBBackup::ProgressHandler &handler)
+{
+    // steps run on another thread while this connection is in use, sqlite has to serialize them.
+    if (sqlite3_db_mutex(m_dbHandle) == NULL) {
+        LOGE("backup of %s needs sqlite in serialized mode", m_path.c_str());
+    }
+    else if (reserveBytes(m_dbHandle) != reserveBytes(destination)) {
+        // sqlcipher keeps its IV and HMAC in the page reserve, plain pages have none.
+        LOGE("backup of %s between an encrypted and a plain database is not supported", m_path.c_str());
+    }
+    else {
+        sqlite3_backup *backup = sqlite3_backup_init(destination, "main", m_dbHandle, "main");
+        if (backup) {
+            m_lastError = DB_OK;
+            return std::unique_ptr<DBBackup>(new DBBackup(backup, destination, owned, pagesPerStep, sleepMs, handler));
+        }
+        LOGE("backup of %s failed: %s", m_path.c_str(), sqlite3_errmsg(destination));
+    }
+
+    if (owned) {
+        sqlite3_close(destination);
+    }
+    m_lastError = DB_ERROR;
+
+    return NULL;
+}
+
+int database::reserveBytes(sqlite3 *handle)
+{
+#ifdef SQLITE_FCNTL_RESERVE_BYTES
+    // a negative value only reads it.
+    int reserve = -1;
+    if (sqlite3_file_control(handle, "main", SQLITE_FCNTL_RESERVE_BYTES, &reserve) != SQLITE_OK) {
+        return -1;
+    }
+
+    return reserve;
+#else
+    (void)handle;
+    return -1;
+#endif
+}
+
+size_t database::changeMark() const
+{
+    return m_changes ? m_changes->mark() : 0;
+}
+
+void database::discardChanges(size_t mark)
+{
+    if (m_changes) {
+        m_changes->truncate(mark);
+    }
+}
+
+// a failed commit either keeps the transaction open or rolls it back through the rollback hook.
+void database::publishChanges()
+{
+    if (m_changes && m_changes->hasPending() && sqlite3_get_autocommit(m_dbHandle) && !writeInProgress()) {
+        m_changes->publish();
+    }
+}
+
+// a write cursor stopped on a row, e.g. INSERT ... RETURNING.
+bool database::writeInProgress() const
+{
+    for (sqlite3_stmt *stmt = sqlite3_next_stmt(m_dbHandle, NULL); stmt; stmt = sqlite3_next_stmt(m_dbHandle, stmt)) {
+        if (sqlite3_stmt_busy(stmt) && !sqlite3_stmt_readonly(stmt)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// statement by statement, so a failing one takes back only its own changes.
+int database::executeTracked(const std::string &sql)
+{
+    const char *next = sql.c_str();
+    int err = SQLITE_OK;
+
+    while (err == SQLITE_OK && *next != '\0') {
+        sqlite3_stmt *stmt = NULL;
+        err = sqlite3_prepare_v2(m_dbHandle, next, -1, &stmt, &next);
+        if (err != SQLITE_OK || stmt == NULL) {
+            // a comment or white space at the end.
+            break;
+        }
+
+        size_t mark = changeMark();
+        do {
+            err = sqlite3_step(stmt);
+        } while (err == SQLITE_ROW);
+
+        if (err == SQLITE_DONE) {
+            err = SQLITE_OK;
+            trackSavepoint(sqlite3_sql(stmt));
+            publishChanges();
+        }
+        else {
+            discardChanges(mark);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    return err;
+}
+
+// savepoints opened through exec(), Transaction's nested scopes included, one statement at a time.
+void database::trackSavepoint(const std::string &sql)
+{
+    std::vector<std::string> words = statementWords(sql);
+    size_t count = words.size();
+    if (count < 2) {
+        return;
+    }
+
+    if (words[0] == "savepoint" && count == 2) {
+        m_changes->savepoint(words[1]);
+    }
+    else if (words[0] == "release" && (count == 2 || (count == 3 && words[1] == "savepoint"))) {
+        m_changes->release(words[count - 1]);
+    }
+    else if (words[0] == "rollback") {
+        size_t i = 1;
+        if (i < count && words[i] == "transaction") {
+            i++;
+        }
+        if (i < count && words[i] == "to") {
+            i++;
+            if (i + 1 < count && words[i] == "savepoint") {
+                i++;
+            }
+            if (i + 1 == count) {
+                m_changes->rollbackTo(words[i]);
+            }
+        }
+    }
+}
+
+// covers what the update hook misses: WITHOUT ROWID tables and truncating deletes.
+void database::tableChanged(const std::string &table)
+{
+    if (m_resultCache) {
+        m_resultCache->invalidate(table.c_str());
+    }
+}
+
+// changes whenever another connection commits to the file.
+int64_t database::dataVersion()
+{
+    static const std::string sql("PRAGMA data_version");
+
+    sqlite3_stmt *stmt = m_statements->acquire(sql);
+    if (stmt == NULL) {
+        return -1;
+    }
+
+    int64_t version = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int64(stmt, 0);
+    }
+    m_statements->release(sql, stmt);
+
+    return version;
+}
+
+int database::lastError() const
+{
+    return m_lastError;
+}
+
+void database::setBusyTimeout(int timeoutMs)
+{
+    m_busyTimeoutMs = timeoutMs > 0 ? timeoutMs : 0;
+    if (m_dbHandle) {
+        sqlite3_busy_handler(m_dbHandle, m_busyTimeoutMs > 0 ? busyHandler : NULL, this);
+    }
+}
+
+void database::setRetryPolicy(const DBRetryPolicy& policy)
+{
+    m_retryPolicy = policy;
+    if (m_retryPolicy.maxRetries < 0) {
+        m_retryPolicy.maxRetries = 0;
+    }
+    if (m_retryPolicy.baseDelayMs < 1) {
+        m_retryPolicy.baseDelayMs = 1;
+    }
+    if (m_retryPolicy.maxDelayMs < m_retryPolicy.baseDelayMs) {
+        m_retryPolicy.maxDelayMs = m_retryPolicy.baseDelayMs;
+    }
+}
+
+void database::setImmediateWrites(bool immediate)
+{
+    m_immediateWrites = immediate;
+}
+
+DBBusyStats database::getBusyStats() const
+{
+    return m_busyStats;
+}
+
+void database::resetBusyStats()
+{
+    m_busyStats = DBBusyStats();
+}
+
+sqlite3_stmt *database::prepare(const std::string &sql)
+{
+    if (m_statements == NULL) {
+        m_lastError = DB_ERROR;
+        return NULL;
+    }
+
+    startCall();
+
+    int err = SQLITE_OK;
+    sqlite3_stmt *stmt = m_statements->acquire(sql, &err);
+    if (stmt == NULL) {
+        finishCall(err);
+    }
+
+    return stmt;
+}
+
+void database::discard(const std::string &sql, sqlite3_stmt *stmt)
+{
+    m_statements->release(sql, stmt);
+    finishCall(SQLITE_ERROR);
+}
+
+int database::setStatus(int err)
+{
+    if (err == SQLITE_OK || err == SQLITE_DONE || err == SQLITE_ROW) {
+        m_lastError = DB_OK;
+    }
+    else if (m_timedOut && (isBusy(err) || (err & 0xff) == SQLITE_INTERRUPT)) {
+        m_lastError = DB_TIMEOUT;
+    }
+    else if ((err & 0xff) == SQLITE_INTERRUPT) {
+        m_lastError = DB_CANCELLED;
+    }
+    else if (isBusy(err)) {
+        m_lastError = DB_BUSY;
+    }
+    else {
+        m_lastError = DB_ERROR;
+    }
+
+    return m_lastError;
+}
+
+void database::setQueryTimeout(int timeoutMs)
+{
+    m_queryTimeoutMs = timeoutMs > 0 ? timeoutMs : 0;
+}
+
+void database::cancel()
+{
+    m_cancelled.store(true);
+    if (m_dbHandle) {
+        sqlite3_interrupt(m_dbHandle);
+    }
+}
+
+// a cancel() that arrives between two calls is dropped here.
+void database::startCall()
+{
+    m_cancelled.store(false);
+    m_timedOut = false;
+    if (m_queryTimeoutMs > 0) {
+        m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_queryTimeoutMs);
+    }
+    else {
+        m_deadline = std::chrono::steady_clock::time_point();
+    }
+}
+
+int database::finishCall(int err)
+{
+    m_deadline = std::chrono::steady_clock::time_point();
+
+    if (err == SQLITE_OK || err == SQLITE_DONE || err == SQLITE_ROW) {
+        publishChanges();
+    }
+
+    return setStatus(err);
+}
+
+bool database::expired()
+{
+    if (m_cancelled.load(std::memory_order_relaxed)) {
+        return true;
+    }
+
+    if (m_deadline != std::chrono::steady_clock::time_point()
+        && std::chrono::steady_clock::now() >= m_deadline) {
+        m_timedOut = true;
+    }
+
+    return m_timedOut;
+}
+
+// waits never run past the deadline, the next check then times out.
+int database::clampToDeadline(int delayMs) const
+{
+    if (m_deadline == std::chrono::steady_clock::time_point()) {
+        return delayMs;
+    }
+
+    int64_t remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                m_deadline - std::chrono::steady_clock::now()).count() + 1;
+    if (remainingMs < delayMs) {
+        return remainingMs > 0 ? static_cast<int>(remainingMs) : 0;
+    }
+
+    return delayMs;
+}
+
+// runs on the stepping thread, a non zero return interrupts the statement.
+int database::progressHandler(void *context)
+{
+    database *self = static_cast<database*>(context);
+
+    return self->expired() ? 1 : 0;
+}
+
+// called by sqlite while another connection holds the lock, 0 gives up with SQLITE_BUSY.
+int database::busyHandler(void *context, int count)
+{
+    database *self = static_cast<database*>(context);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (count == 0) {
+        self->m_busyStart = now;
+    }
+
+    int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - self->m_busyStart).count();
+    int64_t remainingMs = self->m_busyTimeoutMs - elapsedMs;
+    if (self->expired() || remainingMs <= 0) {
+        return 0;
+    }
+
+    int delayMs = self->backoffMs(count);
+    if (delayMs > remainingMs) {
+        delayMs = static_cast<int>(remainingMs);
+    }
+    delayMs = self->clampToDeadline(delayMs);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+
+    self->m_busyStats.waits++;
+    self->m_busyStats.waitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - now).count();
+
+    return 1;
+}
+
+bool database::retryBusy(sqlite3_stmt *stmt, int err, int attempt)
+{
+    if (!isBusy(err)) {
+        return false;
+    }
+    m_busyStats.busy++;
+
+    // restarting inside a transaction could repeat work the caller already saw.
+    if (attempt >= m_retryPolicy.maxRetries || !sqlite3_get_autocommit(m_dbHandle) || expired()) {
+        m_busyStats.failures++;
+        return false;
+    }
+
+    sqlite3_reset(stmt);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(clampToDeadline(backoffMs(attempt))));
+    m_busyStats.retries++;
+    m_busyStats.waitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+    return true;
+}
+
+// exponential backoff with jitter in [delay/2, delay], so waiters do not wake in lockstep.
+int database::backoffMs(int attempt)
+{
+    int64_t delayMs = m_retryPolicy.baseDelayMs;
+    for (int i = 0; i < attempt && delayMs < m_retryPolicy.maxDelayMs; i++) {
+        delayMs *= 2;
+    }
+    if (delayMs > m_retryPolicy.maxDelayMs) {
+        delayMs = m_retryPolicy.maxDelayMs;
+    }
+
+    std::uniform_int_distribution<int64_t> jitter(delayMs / 2, delayMs);
+    return static_cast<int>(jitter(m_random));
 }
 
 int database::fillTable(sqlite3_stmt* stmt, DBDataTable* dataTable)
 {
     int numColumns = sqlite3_column_count(stmt);
     dataTable->setColumnCount(numColumns);
+    for (int i = 0; i < numColumns; i++) {
+        dataTable->setColumnName(i, sqlite3_column_name(stmt, i));
+    }
 
     int addedRows = 0;
 
@@ -359,8 +1694,7 @@ int database::fillTable(sqlite3_stmt* stmt, DBDataTable* dataTable)
                     const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
                     size_t sizeIncludingNull = sqlite3_column_bytes(stmt, i) + 1;
                     if (!dataTable->putString(addedRows, i, text, sizeIncludingNull)) {
-                        // NCDBH_SQL_LOGD("Failed allocating %u bytes for text at %d,%d", sizeIncludingNull, addedRows, i);
-                        std::cout << "failed allocating bytes\n";
+                        LOGE("failed allocating %zu bytes for text at %d,%d", sizeIncludingNull, addedRows, i);
                         break;
                     }
                     // NCDBH_SQL_LOGD("%d,%d is TEXT with %u bytes", addedRows, i, sizeIncludingNull);
@@ -407,33 +1741,104 @@ int database::fillTable(sqlite3_stmt* stmt, DBDataTable* dataTable)
                 }
                 else {
                     // Unknown data
-                    // NCDBH_SQL_LOGE("Unknown column type when filling database data table");
-                    std::cout << "Unknown column type when filling database data table";
+                    LOGE("unknown column type %d when filling database data table", type);
                     break;
                 }
             }
             addedRows++;
         }
         else if (err == SQLITE_DONE) {
-            // complete!
-            std::cout << "complete!\n";
+            LOGD("query complete, %d rows", addedRows);
             break;
         }
-        else if (err == SQLITE_LOCKED || err == SQLITE_BUSY) {
-            // retry?
-            break;
+        else if (isBusy(err)) {
+            // never hand out a truncated result, the caller may retry.
+            LOGW("query stopped after %d rows, database is busy: %d", addedRows, err);
+            return -1;
         }
         else {
-            // exception?
-            std::cout << "query error with : " << err << "\n";
-            break;
+            LOGE("query failed after %d rows: %s", addedRows, sqlite3_errmsg(m_dbHandle));
+            return -1;
         }
     }
 
     return addedRows;
 }
 
-}
+int database::fillTable(sqlite3_stmt* stmt, DBColumnTable* columnTable)
+{
+    int numColumns = columnTable->getColumnCount();
+    for (int i = 0; i < numColumns; i++) {
+        columnTable->setColumnName(i, sqlite3_column_name(stmt, i));
+    }
+
+    while (1) {
+        int err = sqlite3_step(stmt);
+        if (err == SQLITE_ROW) {
+            columnTable->addRow();
+            for (int i = 0; i < numColumns; i++) {
+                int type = sqlite3_column_type(stmt, i);
+                if (type == SQLITE_NULL) {
+                    columnTable->putNull(i);
+                    continue;
+                }
+
+                // values that do not match the column type are converted by sqlite.
+                DBDataType columnType = columnTable->getColumnType(i);
+                if (columnType == DBDataType_Null) {
+                    switch (type) {
+                    case SQLITE_INTEGER:
+                        columnType = DBDataType_Integer;
+                        break;
+                    case SQLITE_FLOAT:
+                        columnType = DBDataType_Float;
+                        break;
+                    case SQLITE_BLOB:
+                        columnType = DBDataType_Blob;
+                        break;
+                    case SQLITE_TEXT:
+                    default:
+                        columnType = DBDataType_String;
+                        break;
+                    }
+                }
 
+                switch (columnType) {
+                case DBDataType_Integer:
+                    columnTable->putLong(i, sqlite3_column_int64(stmt, i));
+                    break;
+                case DBDataType_Float:
+                    columnTable->putDouble(i, sqlite3_column_double(stmt, i));
+                    break;
+                case DBDataType_String:
+                {
+                    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+                    columnTable->putString(i, text, sqlite3_column_bytes(stmt, i));
+                    break;
+                }
+                case DBDataType_Blob:
+                {
+                    const void* blob = sqlite3_column_blob(stmt, i);
+                    columnTable->putBlob(i, blob, sqlite3_column_bytes(stmt, i));
+                    break;
+                }
+                case DBDataType_Null:
+                default:
+                    columnTable->putNull(i);
+                    break;
+                }
+            }
+        }
+        else if (err == SQLITE_DONE) {
+            break;
+        }
+        else {
+            LOGE("query failed after %d rows: %s", columnTable->getRowCount(), sqlite3_errmsg(m_dbHandle));
+            return -1;
+        }
+    }
 
+    return columnTable->getRowCount();
+}
 
+}
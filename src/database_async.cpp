@@ -0,0 +1,365 @@
+#include <cstring>
+
+#include "database_async.h"
+
+#define LOG_TAG "dbhelper"
+#include "database_log.h"
+
+namespace sql
+{
+    AsyncDatabase::Session::Session()
+        : m_async(NULL)
+        , m_strand()
+    {
+    }
+
+    AsyncDatabase::Session::Session(AsyncDatabase* async, const std::shared_ptr<Strand>& strand)
+        : m_async(async)
+        , m_strand(strand)
+    {
+    }
+
+    AsyncDatabase::Session::Session(Session&& x)
+        : m_async(x.m_async)
+        , m_strand(std::move(x.m_strand))
+    {
+        x.m_async = NULL;
+    }
+
+    AsyncDatabase::Session::~Session()
+    {
+        close();
+    }
+
+    AsyncDatabase::Session& AsyncDatabase::Session::operator=(Session&& x)
+    {
+        if (this != &x) {
+            close();
+
+            m_async = x.m_async;
+            m_strand = std::move(x.m_strand);
+            x.m_async = NULL;
+        }
+
+        return *this;
+    }
+
+    void AsyncDatabase::Session::close()
+    {
+        if (m_async && m_strand) {
+            m_async->close(m_strand);
+        }
+
+        m_async = NULL;
+        m_strand.reset();
+    }
+
+    AsyncDatabase::AsyncDatabase(DatabasePool& pool, int readers, size_t capacity, DBAsyncPolicy policy)
+        : m_capacity(capacity > 0 ? capacity : 1)
+        , m_policy(policy)
+        , m_executor()
+        , m_leases()
+        , m_workers()
+        , m_nextReader(0)
+        , m_mutex()
+        , m_work()
+        , m_space()
+        , m_reads()
+        , m_writes()
+        , m_queued(0)
+        , m_stopping(false)
+    {
+        memset(&m_stats, 0, sizeof(m_stats));
+
+        DatabasePool::Lease writer = pool.acquireWriter();
+        if (writer.isValid()) {
+            m_leases.push_back(std::move(writer));
+
+            // a pool without read connections hands out the writer, which is ours already.
+            int count = readers < pool.getReaderCount() ? readers : pool.getReaderCount();
+            for (int i = 0; i < count; i++) {
+                DatabasePool::Lease reader = pool.acquireReader();
+                if (reader.isValid()) {
+                    m_leases.push_back(std::move(reader));
+                }
+            }
+        }
+
+        for (size_t i = 0; i < m_leases.size(); i++) {
+            Worker* worker = new Worker();
+            worker->db = m_leases[i].get();
+            worker->reads = (i > 0);
+            m_workers.push_back(worker);
+        }
+
+        start();
+    }
+
+    AsyncDatabase::AsyncDatabase(database& db, size_t capacity, DBAsyncPolicy policy)
+        : m_capacity(capacity > 0 ? capacity : 1)
+        , m_policy(policy)
+        , m_executor()
+        , m_leases()
+        , m_workers()
+        , m_nextReader(0)
+        , m_mutex()
+        , m_work()
+        , m_space()
+        , m_reads()
+        , m_writes()
+        , m_queued(0)
+        , m_stopping(false)
+    {
+        memset(&m_stats, 0, sizeof(m_stats));
+
+        Worker* worker = new Worker();
+        worker->db = &db;
+        worker->reads = false;
+        m_workers.push_back(worker);
+
+        start();
+    }
+
+    AsyncDatabase::~AsyncDatabase()
+    {
+        stop();
+
+        for (size_t i = 0; i < m_workers.size(); i++) {
+            delete m_workers[i];
+        }
+    }
+
+    void AsyncDatabase::start()
+    {
+        for (size_t i = 0; i < m_workers.size(); i++) {
+            m_workers[i]->thread = std::thread(&AsyncDatabase::run, this, m_workers[i]);
+        }
+    }
+
+    void AsyncDatabase::setExecutor(const Executor& executor)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_executor = executor;
+    }
+
+    std::future<std::unique_ptr<DBDataTable> > AsyncDatabase::rawQuery(const std::string& sql,
+                                                                       const std::vector<std::string>& args)
+    {
+        return submit([sql, args](database& db) {
+            return db.rawQuery(sql, args);
+        });
+    }
+
+    std::future<int> AsyncDatabase::exec(const std::string& sql)
+    {
+        return submit([sql](database& db) {
+            return db.exec(sql);
+        }, DBAsync_Write);
+    }
+
+    std::future<int64_t> AsyncDatabase::insert(const std::string& table, const DBDataRow& values)
+    {
+        return submit([table, values](database& db) {
+            return db.insert(table, values);
+        }, DBAsync_Write);
+    }
+
+    std::future<int> AsyncDatabase::update(const std::string& table, const DBDataRow& values,
+                                           const std::string& where, const std::vector<std::string>& whereArgs)
+    {
+        return submit([table, values, where, whereArgs](database& db) {
+            return db.update(table, values, where, whereArgs);
+        }, DBAsync_Write);
+    }
+
+    std::future<int> AsyncDatabase::remove(const std::string& table, const std::string& where,
+                                           const std::vector<std::string>& whereArgs)
+    {
+        return submit([table, where, whereArgs](database& db) {
+            return db.remove(table, where, whereArgs);
+        }, DBAsync_Write);
+    }
+
+    AsyncDatabase::Session AsyncDatabase::session(DBAsyncMode mode)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping || m_workers.empty()) {
+            return Session();
+        }
+
+        // readers take turns, the writer is always the first worker.
+        Worker* worker = m_workers[0];
+        if (mode == DBAsync_Read && m_workers.size() > 1) {
+            worker = m_workers[1 + m_nextReader++ % (m_workers.size() - 1)];
+        }
+
+        std::shared_ptr<Strand> strand(new Strand());
+        strand->worker = worker;
+        strand->closed = false;
+        worker->sessions.push_back(strand);
+
+        return Session(this, strand);
+    }
+
+    void AsyncDatabase::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_work.notify_all();
+        m_space.notify_all();
+
+        for (size_t i = 0; i < m_workers.size(); i++) {
+            if (m_workers[i]->thread.joinable()) {
+                m_workers[i]->thread.join();
+            }
+        }
+    }
+
+    DBAsyncStats AsyncDatabase::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    int AsyncDatabase::post(const Task& task, DBAsyncMode mode, const std::shared_ptr<Strand>& strand)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (!m_stopping && m_queued >= m_capacity) {
+            if (m_policy == DBAsync_Reject) {
+                m_stats.rejected++;
+                return DB_REJECTED;
+            }
+
+            m_stats.blocked++;
+            while (!m_stopping && m_queued >= m_capacity) {
+                m_space.wait(lock);
+            }
+        }
+
+        if (m_stopping || m_workers.empty() || (strand && strand->closed)) {
+            m_stats.rejected++;
+            return DB_REJECTED;
+        }
+
+        if (strand) {
+            strand->tasks.push_back(task);
+        }
+        else if (mode == DBAsync_Read && m_workers.size() > 1) {
+            m_reads.push_back(task);
+        }
+        else {
+            // a single connection serves reads in order with the writes.
+            m_writes.push_back(task);
+        }
+
+        m_queued++;
+        m_stats.submitted++;
+        if (m_queued > m_stats.maxQueued) {
+            m_stats.maxQueued = m_queued;
+        }
+        lock.unlock();
+
+        m_work.notify_all();
+
+        return DB_OK;
+    }
+
+    void AsyncDatabase::complete(const std::function<void()>& completion)
+    {
+        Executor executor;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            executor = m_executor;
+        }
+
+        if (executor) {
+            executor(completion);
+        }
+        else {
+            completion();
+        }
+    }
+
+    void AsyncDatabase::drop(const std::exception_ptr& error)
+    {
+        try {
+            std::rethrow_exception(error);
+        }
+        catch (const std::exception& e) {
+            LOGE("async operation threw: %s", e.what());
+        }
+        catch (...) {
+            LOGE("async operation threw");
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.dropped++;
+    }
+
+    void AsyncDatabase::close(const std::shared_ptr<Strand>& strand)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            strand->closed = true;
+        }
+        m_work.notify_all();
+    }
+
+    bool AsyncDatabase::next(Worker* worker, std::unique_lock<std::mutex>& lock, Task& task)
+    {
+        while (true) {
+            if (!worker->owner && !worker->sessions.empty()) {
+                worker->owner = worker->sessions.front();
+                worker->sessions.pop_front();
+            }
+
+            std::deque<Task>* queue = NULL;
+            if (worker->owner) {
+                queue = &worker->owner->tasks;
+                // an open session keeps its connection even while it is idle.
+                if (queue->empty() && (worker->owner->closed || m_stopping)) {
+                    worker->owner.reset();
+                    continue;
+                }
+            }
+            else {
+                queue = worker->reads ? &m_reads : &m_writes;
+            }
+
+            if (!queue->empty()) {
+                task = std::move(queue->front());
+                queue->pop_front();
+                m_queued--;
+                return true;
+            }
+
+            if (m_stopping && !worker->owner && worker->sessions.empty()) {
+                return false;
+            }
+
+            m_work.wait(lock);
+        }
+    }
+
+    void AsyncDatabase::run(Worker* worker)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        Task task;
+        while (next(worker, lock, task)) {
+            lock.unlock();
+            m_space.notify_one();
+
+            task(*worker->db);
+            task = Task();
+
+            lock.lock();
+            m_stats.completed++;
+        }
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,132 @@
+#include <chrono>
+
+#include "database.h"
+#include "database_backup.h"
+#include "sqlite3.h"
+
+#define LOG_TAG "dbhelper"
+#include "database_log.h"
+
+namespace sql
+{
+    DBBackup::DBBackup(sqlite3_backup* backup, sqlite3* destination, bool owned,
+                       int pagesPerStep, int sleepMs, const ProgressHandler& handler)
+        : m_backup(backup)
+        , m_destination(destination)
+        , m_owned(owned)
+        , m_pagesPerStep(pagesPerStep > 0 ? pagesPerStep : -1)
+        , m_sleepMs(sleepMs > 0 ? sleepMs : 0)
+        , m_handler(handler)
+        , m_mutex()
+        , m_changed()
+        , m_progress()
+        , m_done(false)
+        , m_result(DB_OK)
+        , m_cancelled(false)
+        , m_thread()
+    {
+        m_thread = std::thread(&DBBackup::run, this);
+    }
+
+    DBBackup::~DBBackup()
+    {
+        wait();
+    }
+
+    int DBBackup::wait()
+    {
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_result;
+    }
+
+    bool DBBackup::isDone() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_done;
+    }
+
+    DBBackupProgress DBBackup::getProgress() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_progress;
+    }
+
+    void DBBackup::cancel()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancelled = true;
+        }
+        m_changed.notify_all();
+    }
+
+    void DBBackup::run()
+    {
+        int err = SQLITE_OK;
+        while (!m_cancelled) {
+            // the source is locked only while a step runs.
+            err = sqlite3_backup_step(m_backup, m_pagesPerStep);
+            int code = err & 0xff;
+
+            DBBackupProgress progress;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_progress.remaining = sqlite3_backup_remaining(m_backup);
+                m_progress.pageCount = sqlite3_backup_pagecount(m_backup);
+                m_progress.steps++;
+                if (code == SQLITE_BUSY || code == SQLITE_LOCKED) {
+                    m_progress.busy++;
+                }
+                progress = m_progress;
+            }
+
+            if (m_handler) {
+                m_handler(progress);
+            }
+
+            bool locked = (code == SQLITE_BUSY || code == SQLITE_LOCKED);
+            if (err != SQLITE_OK && !locked) {
+                break;
+            }
+
+            // a locked source is retried, but not without a pause even when sleepMs is 0.
+            int sleepMs = (locked && m_sleepMs < BusySleepMs) ? BusySleepMs : m_sleepMs;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait_for(lock, std::chrono::milliseconds(sleepMs), [this]() { return m_cancelled.load(); });
+        }
+
+        // an unfinished backup is rolled back, the destination keeps its old content.
+        int finish = sqlite3_backup_finish(m_backup);
+        m_backup = NULL;
+
+        int result = DB_OK;
+        if (err != SQLITE_DONE) {
+            result = m_cancelled ? DB_CANCELLED : DB_ERROR;
+        }
+        else if (finish != SQLITE_OK) {
+            result = DB_ERROR;
+        }
+
+        if (result == DB_ERROR) {
+            LOGE("backup failed: %d, %s", (err != SQLITE_DONE) ? err : finish, sqlite3_errmsg(m_destination));
+        }
+
+        if (m_owned) {
+            sqlite3_close(m_destination);
+        }
+        m_destination = NULL;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_result = result;
+            m_done = true;
+        }
+        m_changed.notify_all();
+    }
+
+} /* namespace sql */
+/* EOF */
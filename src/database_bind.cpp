@@ -0,0 +1,74 @@
+#include "database_bind.h"
+#include "sqlite3.h"
+
+namespace sql
+{
+    int bindValue(sqlite3_stmt* stmt, int index, int64_t value, bool copy)
+    {
+        (void)copy;
+        return sqlite3_bind_int64(stmt, index, value);
+    }
+
+    int bindValue(sqlite3_stmt* stmt, int index, double value, bool copy)
+    {
+        (void)copy;
+        return sqlite3_bind_double(stmt, index, value);
+    }
+
+    int bindValue(sqlite3_stmt* stmt, int index, const std::string& value, bool copy)
+    {
+        return sqlite3_bind_text(stmt, index, value.data(), value.length(),
+                                 copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+    }
+
+    int bindValue(sqlite3_stmt* stmt, int index, const char* value, bool copy)
+    {
+        if (NULL == value) {
+            return sqlite3_bind_null(stmt, index);
+        }
+
+        return sqlite3_bind_text(stmt, index, value, -1,
+                                 copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+    }
+
+    int bindValue(sqlite3_stmt* stmt, int index, const DBTextView& value, bool copy)
+    {
+        (void)copy;
+        if (NULL == value.data) {
+            return sqlite3_bind_null(stmt, index);
+        }
+
+        return sqlite3_bind_text(stmt, index, value.data, value.length, SQLITE_STATIC);
+    }
+
+    int bindValue(sqlite3_stmt* stmt, int index, const DBBlobView& value, bool copy)
+    {
+        (void)copy;
+        if (NULL == value.data) {
+            return sqlite3_bind_null(stmt, index);
+        }
+
+        return sqlite3_bind_blob(stmt, index, value.data, value.size, SQLITE_STATIC);
+    }
+
+    int bindValue(sqlite3_stmt* stmt, int index, std::nullptr_t value, bool copy)
+    {
+        (void)value;
+        (void)copy;
+        return sqlite3_bind_null(stmt, index);
+    }
+
+    int bindStrings(sqlite3_stmt* stmt, int index, bool copy, const std::vector<std::string>& args)
+    {
+        for (size_t i = 0; i < args.size(); i++) {
+            int err = bindValue(stmt, index + i, args[i], copy);
+            if (err != SQLITE_OK) {
+                return err;
+            }
+        }
+
+        return SQLITE_OK;
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,205 @@
+#include <ctype.h>
+#include <set>
+
+#include "database_cache.h"
+#include "sqlite3.h"
+
+namespace sql
+{
+    DBResultCache::DBResultCache(size_t budgetBytes)
+        : m_budget(budgetBytes)
+        , m_bytes(0)
+        , m_entries()
+        , m_index()
+        , m_versions()
+        , m_reads()
+        , m_hits(0)
+        , m_misses(0)
+        , m_invalidations(0)
+        , m_evictions(0)
+    {
+    }
+
+    void DBResultCache::setBudget(size_t budgetBytes)
+    {
+        m_budget = budgetBytes;
+        evict(m_budget);
+    }
+
+    bool DBResultCache::lookup(const std::string& key, std::shared_ptr<const DBDataTable>& table)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            m_misses++;
+            return false;
+        }
+
+        EntryList::iterator entry = it->second;
+        for (size_t i = 0; i < entry->reads.size(); i++) {
+            if (version(entry->reads[i].table) != entry->reads[i].version) {
+                erase(entry);
+                m_invalidations++;
+                m_misses++;
+                return false;
+            }
+        }
+
+        m_entries.splice(m_entries.begin(), m_entries, entry);
+        table = entry->table;
+        m_hits++;
+
+        return true;
+    }
+
+    void DBResultCache::insert(const std::string& key, const std::shared_ptr<const DBDataTable>& table,
+                               const std::vector<std::string>& tables)
+    {
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            erase(it->second);
+        }
+
+        size_t bytes = sizeof(Entry) + key.size() + (table ? table->getMemoryUsage() : 0);
+        if (bytes > m_budget) {
+            return;
+        }
+        evict(m_budget - bytes);
+
+        Entry entry;
+        entry.key = key;
+        entry.table = table;
+        entry.bytes = bytes;
+        for (size_t i = 0; i < tables.size(); i++) {
+            Dependency read;
+            read.table = lower(tables[i].c_str());
+            read.version = version(read.table);
+            entry.reads.push_back(read);
+        }
+
+        m_entries.push_front(entry);
+        m_index[key] = m_entries.begin();
+        m_bytes += bytes;
+    }
+
+    // called for every changed row, so only the version is bumped here.
+    void DBResultCache::invalidate(const char* table)
+    {
+        if (m_entries.empty() || table == NULL) {
+            return;
+        }
+
+        m_versions[lower(table)]++;
+    }
+
+    void DBResultCache::clear()
+    {
+        m_invalidations += m_entries.size();
+        m_entries.clear();
+        m_index.clear();
+        m_versions.clear();
+        // the schema may have changed as well.
+        m_reads.clear();
+        m_bytes = 0;
+    }
+
+    DBResultCacheStats DBResultCache::getStats() const
+    {
+        DBResultCacheStats stats;
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        stats.invalidations = m_invalidations;
+        stats.evictions = m_evictions;
+        stats.entries = m_entries.size();
+        stats.bytes = m_bytes;
+        stats.budget = m_budget;
+
+        return stats;
+    }
+
+    // arguments are length prefixed, so no two argument lists share a key.
+    std::string DBResultCache::makeKey(const std::string& sql, const std::vector<std::string>& args)
+    {
+        std::string key(sql);
+        for (size_t i = 0; i < args.size(); i++) {
+            key.push_back('\0');
+            key.append(std::to_string(args[i].size()));
+            key.push_back(':');
+            key.append(args[i]);
+        }
+
+        return key;
+    }
+
+    static int collectReads(void* context, int action, const char* table, const char*, const char*, const char*)
+    {
+        if (action == SQLITE_READ && table != NULL) {
+            static_cast<std::set<std::string>*>(context)->insert(table);
+        }
+
+        return SQLITE_OK;
+    }
+
+    bool DBResultCache::getReadTables(sqlite3* handle, const std::string& sql, std::vector<std::string>& tables)
+    {
+        auto it = m_reads.find(sql);
+        if (it != m_reads.end()) {
+            tables = it->second;
+            return true;
+        }
+
+        // views are expanded while preparing, the authorizer sees their base tables.
+        std::set<std::string> reads;
+        sqlite3_set_authorizer(handle, collectReads, &reads);
+
+        sqlite3_stmt* stmt = NULL;
+        int err = sqlite3_prepare_v2(handle, sql.c_str(), sql.size(), &stmt, NULL);
+        sqlite3_finalize(stmt);
+
+        sqlite3_set_authorizer(handle, NULL, NULL);
+
+        if (err != SQLITE_OK) {
+            return false;
+        }
+
+        tables.assign(reads.begin(), reads.end());
+        m_reads[sql] = tables;
+
+        return true;
+    }
+
+    uint64_t DBResultCache::version(const std::string& table) const
+    {
+        auto it = m_versions.find(table);
+
+        return (it != m_versions.end()) ? it->second : 0;
+    }
+
+    void DBResultCache::erase(EntryList::iterator it)
+    {
+        m_bytes -= it->bytes;
+        m_index.erase(it->key);
+        m_entries.erase(it);
+    }
+
+    void DBResultCache::evict(size_t budget)
+    {
+        while (m_bytes > budget && !m_entries.empty()) {
+            EntryList::iterator last = m_entries.end();
+            --last;
+            erase(last);
+            m_evictions++;
+        }
+    }
+
+    std::string DBResultCache::lower(const char* name)
+    {
+        std::string result(name);
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = tolower(static_cast<unsigned char>(result[i]));
+        }
+
+        return result;
+    }
+
+} /* namespace sql */
+/* EOF */
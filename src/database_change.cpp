@@ -0,0 +1,212 @@
+#include "database_change.h"
+
+namespace sql
+{
+    DBChangeFeed::DBChangeFeed(size_t capacity, const Notify& notify)
+        : m_slots()
+        , m_mask(0)
+        , m_notify(notify)
+        , m_head(0)
+        , m_padding()
+        , m_tail(0)
+        , m_dropped(0)
+        , m_closed(false)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    bool DBChangeFeed::poll(DBChange& change)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        // moved out, so the slot does not keep the values alive until it is reused.
+        change = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    uint64_t DBChangeFeed::getDropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    bool DBChangeFeed::isClosed() const
+    {
+        return m_closed.load(std::memory_order_acquire);
+    }
+
+    bool DBChangeFeed::push(const DBChange& change)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_slots[tail & m_mask] = change;
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    void DBChangeFeed::close()
+    {
+        m_closed.store(true, std::memory_order_release);
+    }
+
+    DBChangeLog::DBChangeLog()
+        : m_pending()
+        , m_savepoints()
+        , m_feeds()
+        , m_sequence(0)
+    {
+    }
+
+    DBChangeLog::~DBChangeLog()
+    {
+        for (size_t i = 0; i < m_feeds.size(); i++) {
+            m_feeds[i]->close();
+        }
+    }
+
+    std::shared_ptr<DBChangeFeed> DBChangeLog::subscribe(size_t capacity, const DBChangeFeed::Notify& notify)
+    {
+        std::shared_ptr<DBChangeFeed> feed(new DBChangeFeed(capacity, notify));
+        m_feeds.push_back(feed);
+
+        return feed;
+    }
+
+    void DBChangeLog::unsubscribe(const std::shared_ptr<DBChangeFeed>& feed)
+    {
+        for (size_t i = 0; i < m_feeds.size(); i++) {
+            if (m_feeds[i] == feed) {
+                feed->close();
+                m_feeds.erase(m_feeds.begin() + i);
+                break;
+            }
+        }
+    }
+
+    bool DBChangeLog::hasSubscribers() const
+    {
+        return !m_feeds.empty();
+    }
+
+    bool DBChangeLog::hasPending() const
+    {
+        return !m_pending.empty();
+    }
+
+    void DBChangeLog::record(DBChangeOp op, const char* table, int64_t rowid,
+                             const std::shared_ptr<const DBDataRow>& oldValues,
+                             const std::shared_ptr<const DBDataRow>& newValues)
+    {
+        DBChange change;
+        change.op = op;
+        change.table = table;
+        change.rowid = rowid;
+        change.sequence = 0;
+        change.oldValues = oldValues;
+        change.newValues = newValues;
+
+        m_pending.push_back(std::move(change));
+    }
+
+    size_t DBChangeLog::mark() const
+    {
+        return m_pending.size();
+    }
+
+    void DBChangeLog::truncate(size_t mark)
+    {
+        // a rollback may have emptied the log since the mark was taken.
+        if (mark < m_pending.size()) {
+            m_pending.erase(m_pending.begin() + mark, m_pending.end());
+        }
+    }
+
+    void DBChangeLog::savepoint(const std::string& name)
+    {
+        Savepoint savepoint;
+        savepoint.name = name;
+        savepoint.mark = m_pending.size();
+
+        m_savepoints.push_back(savepoint);
+    }
+
+    // like sqlite, the innermost savepoint of that name and every one opened after it.
+    void DBChangeLog::release(const std::string& name)
+    {
+        for (size_t i = m_savepoints.size(); i > 0; i--) {
+            if (m_savepoints[i - 1].name == name) {
+                m_savepoints.erase(m_savepoints.begin() + (i - 1), m_savepoints.end());
+                break;
+            }
+        }
+    }
+
+    // the savepoint itself stays open after ROLLBACK TO.
+    void DBChangeLog::rollbackTo(const std::string& name)
+    {
+        for (size_t i = m_savepoints.size(); i > 0; i--) {
+            if (m_savepoints[i - 1].name == name) {
+                truncate(m_savepoints[i - 1].mark);
+                m_savepoints.erase(m_savepoints.begin() + i, m_savepoints.end());
+                break;
+            }
+        }
+    }
+
+    void DBChangeLog::publish()
+    {
+        m_savepoints.clear();
+        if (m_pending.empty()) {
+            return;
+        }
+
+        m_sequence++;
+        for (size_t i = 0; i < m_pending.size(); i++) {
+            m_pending[i].sequence = m_sequence;
+        }
+
+        for (size_t i = 0; i < m_feeds.size(); ) {
+            std::shared_ptr<DBChangeFeed>& feed = m_feeds[i];
+
+            // nobody polls a feed only this log still holds.
+            if (feed.use_count() == 1) {
+                m_feeds.erase(m_feeds.begin() + i);
+                continue;
+            }
+
+            bool pushed = false;
+            for (size_t j = 0; j < m_pending.size(); j++) {
+                pushed = feed->push(m_pending[j]) || pushed;
+            }
+            if (pushed && feed->m_notify) {
+                feed->m_notify();
+            }
+            i++;
+        }
+
+        m_pending.clear();
+    }
+
+    void DBChangeLog::rollback()
+    {
+        m_pending.clear();
+        m_savepoints.clear();
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,339 @@
+#include <utility>
+
+#include "database_column.h"
+
+namespace sql
+{
+    DBColumnTable::DBColumnTable(int columnCount)
+        : m_rowCount(0)
+        , m_columns(columnCount > 0 ? columnCount : 0)
+    {
+    }
+
+    DBColumnTable::DBColumnTable(DBColumnTable&& x)
+        : m_rowCount(x.m_rowCount)
+        , m_columns(std::move(x.m_columns))
+    {
+        x.m_rowCount = 0;
+        x.m_columns.clear();
+    }
+
+    DBColumnTable::~DBColumnTable()
+    {
+    }
+
+    DBColumnTable& DBColumnTable::operator=(DBColumnTable&& x)
+    {
+        if (this != &x) {
+            m_rowCount = x.m_rowCount;
+            m_columns = std::move(x.m_columns);
+            x.m_rowCount = 0;
+            x.m_columns.clear();
+        }
+
+        return *this;
+    }
+
+    int DBColumnTable::getRowCount() const
+    {
+        return m_rowCount;
+    }
+
+    int DBColumnTable::getColumnCount() const
+    {
+        return m_columns.size();
+    }
+
+    bool DBColumnTable::setColumnName(int column, const char* name)
+    {
+        if (column < 0 || column >= (int)m_columns.size() || NULL == name) {
+            return false;
+        }
+
+        m_columns[column].name.assign(name);
+
+        return true;
+    }
+
+    const std::string& DBColumnTable::getColumnName(int column) const
+    {
+        static const std::string empty;
+
+        if (column < 0 || column >= (int)m_columns.size()) {
+            return empty;
+        }
+
+        return m_columns[column].name;
+    }
+
+    DBDataType DBColumnTable::getColumnType(int column) const
+    {
+        if (column < 0 || column >= (int)m_columns.size()) {
+            return DBDataType_Null;
+        }
+
+        return m_columns[column].type;
+    }
+
+    void DBColumnTable::addRow()
+    {
+        m_rowCount++;
+    }
+
+    bool DBColumnTable::putBlob(int column, const void* value, size_t size)
+    {
+        Column* col = next(column, DBDataType_Blob);
+        if (NULL == col) {
+            return false;
+        }
+
+        const char* data = static_cast<const char*>(value);
+        if (data) {
+            col->bytes.insert(col->bytes.end(), data, data + size);
+        }
+        col->offsets.push_back(col->bytes.size());
+        col->size++;
+
+        return true;
+    }
+
+    bool DBColumnTable::putString(int column, const char* value, size_t length)
+    {
+        Column* col = next(column, DBDataType_String);
+        if (NULL == col) {
+            return false;
+        }
+
+        if (value) {
+            col->bytes.insert(col->bytes.end(), value, value + length);
+        }
+        // keep every string terminated like DBDataCell does.
+        col->bytes.push_back('\0');
+        col->offsets.push_back(col->bytes.size());
+        col->size++;
+
+        return true;
+    }
+
+    bool DBColumnTable::putLong(int column, int64_t value)
+    {
+        Column* col = next(column, DBDataType_Integer);
+        if (NULL == col) {
+            return false;
+        }
+
+        col->longs.push_back(value);
+        col->size++;
+
+        return true;
+    }
+
+    bool DBColumnTable::putDouble(int column, double value)
+    {
+        Column* col = next(column, DBDataType_Float);
+        if (NULL == col) {
+            return false;
+        }
+
+        col->doubles.push_back(value);
+        col->size++;
+
+        return true;
+    }
+
+    bool DBColumnTable::putNull(int column)
+    {
+        Column* col = next(column, DBDataType_Null);
+        if (NULL == col) {
+            return false;
+        }
+
+        markNull(*col);
+        pad(*col);
+        col->size++;
+
+        return true;
+    }
+
+    bool DBColumnTable::isNull(int row, int column) const
+    {
+        if (column < 0 || column >= (int)m_columns.size()) {
+            return true;
+        }
+
+        const Column& col = m_columns[column];
+        if (row < 0 || row >= col.size) {
+            return true;
+        }
+
+        return (col.nulls[row >> 3] & (1 << (row & 7))) != 0;
+    }
+
+    int64_t DBColumnTable::getLong(int row, int column) const
+    {
+        if (getColumnType(column) != DBDataType_Integer || isNull(row, column)) {
+            return 0;
+        }
+
+        return m_columns[column].longs[row];
+    }
+
+    double DBColumnTable::getDouble(int row, int column) const
+    {
+        if (getColumnType(column) != DBDataType_Float || isNull(row, column)) {
+            return 0;
+        }
+
+        return m_columns[column].doubles[row];
+    }
+
+    const char* DBColumnTable::getString(int row, int column, size_t& length) const
+    {
+        if (getColumnType(column) != DBDataType_String || isNull(row, column)) {
+            return NULL;
+        }
+
+        const Column& col = m_columns[column];
+        length = col.offsets[row + 1] - col.offsets[row] - 1;
+
+        return &col.bytes[col.offsets[row]];
+    }
+
+    const void* DBColumnTable::getBlob(int row, int column, size_t& size) const
+    {
+        if (getColumnType(column) != DBDataType_Blob || isNull(row, column)) {
+            return NULL;
+        }
+
+        const Column& col = m_columns[column];
+        size = col.offsets[row + 1] - col.offsets[row];
+        if (0 == size) {
+            return NULL;
+        }
+
+        return &col.bytes[col.offsets[row]];
+    }
+
+    const int64_t* DBColumnTable::getLongColumn(int column) const
+    {
+        if (getColumnType(column) != DBDataType_Integer || m_columns[column].longs.empty()) {
+            return NULL;
+        }
+
+        return &m_columns[column].longs[0];
+    }
+
+    const double* DBColumnTable::getDoubleColumn(int column) const
+    {
+        if (getColumnType(column) != DBDataType_Float || m_columns[column].doubles.empty()) {
+            return NULL;
+        }
+
+        return &m_columns[column].doubles[0];
+    }
+
+    const uint8_t* DBColumnTable::getNullBitmap(int column) const
+    {
+        if (column < 0 || column >= (int)m_columns.size() || m_columns[column].nulls.empty()) {
+            return NULL;
+        }
+
+        return &m_columns[column].nulls[0];
+    }
+
+    DBColumnTable::Column* DBColumnTable::next(int column, DBDataType type)
+    {
+        if (column < 0 || column >= (int)m_columns.size()) {
+            return NULL;
+        }
+
+        Column& col = m_columns[column];
+        if (col.size >= m_rowCount) {
+            // this row already has a value.
+            return NULL;
+        }
+
+        if (type != DBDataType_Null) {
+            if (col.type == DBDataType_Null) {
+                settle(col, type);
+            }
+            else if (col.type != type) {
+                return NULL;
+            }
+        }
+
+        // rows skipped by the caller read as null.
+        while (col.size < m_rowCount - 1) {
+            markNull(col);
+            pad(col);
+            col.size++;
+        }
+
+        if ((size_t)(col.size >> 3) >= col.nulls.size()) {
+            col.nulls.push_back(0);
+        }
+
+        return &col;
+    }
+
+    void DBColumnTable::settle(Column& col, DBDataType type)
+    {
+        col.type = type;
+
+        // rows before the first value were all null.
+        switch (type) {
+        case DBDataType_Integer:
+            col.longs.assign(col.size, 0);
+            break;
+        case DBDataType_Float:
+            col.doubles.assign(col.size, 0);
+            break;
+        case DBDataType_String:
+            col.bytes.assign(col.size, '\0');
+            col.offsets.resize(col.size + 1);
+            for (int i = 0; i <= col.size; i++) {
+                col.offsets[i] = i;
+            }
+            break;
+        case DBDataType_Blob:
+            col.offsets.assign(col.size + 1, 0);
+            break;
+        case DBDataType_Null:
+        default:
+            break;
+        }
+    }
+
+    void DBColumnTable::pad(Column& col)
+    {
+        switch (col.type) {
+        case DBDataType_Integer:
+            col.longs.push_back(0);
+            break;
+        case DBDataType_Float:
+            col.doubles.push_back(0);
+            break;
+        case DBDataType_String:
+            col.bytes.push_back('\0');
+            col.offsets.push_back(col.bytes.size());
+            break;
+        case DBDataType_Blob:
+            col.offsets.push_back(col.bytes.size());
+            break;
+        case DBDataType_Null:
+        default:
+            break;
+        }
+    }
+
+    void DBColumnTable::markNull(Column& col)
+    {
+        if ((size_t)(col.size >> 3) >= col.nulls.size()) {
+            col.nulls.push_back(0);
+        }
+
+        col.nulls[col.size >> 3] |= (1 << (col.size & 7));
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,174 @@
+#include "database.h"
+#include "database_cursor.h"
+#include "database_statement.h"
+#include "sqlite3.h"
+
+namespace sql
+{
+    Cursor::Cursor(database* owner, DBStatementCache* cache, const std::string& sql, sqlite3_stmt* stmt)
+        : m_owner(owner)
+        , m_cache(cache)
+        , m_sql(sql)
+        , m_stmt(stmt)
+        , m_columnCount(0)
+        , m_error(SQLITE_OK)
+    {
+        if (m_stmt) {
+            m_columnCount = sqlite3_column_count(m_stmt);
+        }
+    }
+
+    Cursor::~Cursor()
+    {
+        close();
+    }
+
+    bool Cursor::next()
+    {
+        // stepping after DONE or an error would reset the statement and run it again.
+        if (NULL == m_stmt || (m_error != SQLITE_OK && m_error != SQLITE_ROW)) {
+            return false;
+        }
+
+        size_t mark = m_owner ? m_owner->changeMark() : 0;
+        m_error = sqlite3_step(m_stmt);
+        if (m_owner) {
+            m_owner->cursorStepped(m_stmt, m_error, mark);
+        }
+        if (m_error == SQLITE_ROW) {
+            return true;
+        }
+
+        return false;
+    }
+
+    void Cursor::close()
+    {
+        if (NULL == m_stmt) {
+            return;
+        }
+
+        if (m_cache) {
+            m_cache->release(m_sql, m_stmt);
+        }
+        else {
+            sqlite3_finalize(m_stmt);
+        }
+        m_stmt = NULL;
+
+        if (m_owner) {
+            m_owner->cursorClosed();
+        }
+    }
+
+    bool Cursor::isClosed() const
+    {
+        return (NULL == m_stmt);
+    }
+
+    int Cursor::getError() const
+    {
+        return m_error;
+    }
+
+    bool Cursor::isDone() const
+    {
+        return (m_error == SQLITE_DONE);
+    }
+
+    int Cursor::getColumnCount() const
+    {
+        return m_columnCount;
+    }
+
+    const char* Cursor::getColumnName(int column) const
+    {
+        if (NULL == m_stmt || column >= m_columnCount) {
+            return NULL;
+        }
+
+        return sqlite3_column_name(m_stmt, column);
+    }
+
+    int Cursor::getColumnIndex(const std::string& name) const
+    {
+        for (int i = 0; i < m_columnCount; i++) {
+            const char* columnName = getColumnName(i);
+            if (columnName && name == columnName) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    DBDataType Cursor::getType(int column) const
+    {
+        if (NULL == m_stmt || column >= m_columnCount) {
+            return DBDataType_Null;
+        }
+
+        switch (sqlite3_column_type(m_stmt, column)) {
+        case SQLITE_INTEGER:
+            return DBDataType_Integer;
+        case SQLITE_FLOAT:
+            return DBDataType_Float;
+        case SQLITE_TEXT:
+            return DBDataType_String;
+        case SQLITE_BLOB:
+            return DBDataType_Blob;
+        case SQLITE_NULL:
+        default:
+            return DBDataType_Null;
+        }
+    }
+
+    bool Cursor::isNull(int column) const
+    {
+        return (getType(column) == DBDataType_Null);
+    }
+
+    int64_t Cursor::getLong(int column) const
+    {
+        if (NULL == m_stmt || column >= m_columnCount) {
+            return 0;
+        }
+
+        return sqlite3_column_int64(m_stmt, column);
+    }
+
+    double Cursor::getDouble(int column) const
+    {
+        if (NULL == m_stmt || column >= m_columnCount) {
+            return 0;
+        }
+
+        return sqlite3_column_double(m_stmt, column);
+    }
+
+    const char* Cursor::getString(int column, size_t& length) const
+    {
+        if (NULL == m_stmt || column >= m_columnCount) {
+            return NULL;
+        }
+
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(m_stmt, column));
+        length = sqlite3_column_bytes(m_stmt, column);
+
+        return text;
+    }
+
+    const void* Cursor::getBlob(int column, size_t& size) const
+    {
+        if (NULL == m_stmt || column >= m_columnCount) {
+            return NULL;
+        }
+
+        const void* blob = sqlite3_column_blob(m_stmt, column);
+        size = sqlite3_column_bytes(m_stmt, column);
+
+        return blob;
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -1,53 +1,217 @@
 #include <stdlib.h>
 #include <cstring>
+#include <utility>
 #include "database_data.h"
 
 #define LOG_TAG "dbhelper"
 
 #define DBDATA_CELL_FREE(X) \
     { \
-        if ((DBDataType_String == X.type || DBDataType_Blob == X.type) \
-                && NULL != X.data.buffer.ptr) { \
-            free(X.data.buffer.ptr); \
+        if ((DBDataType_String == X.type || DBDataType_Blob == X.type)) { \
+            if (Storage_Heap == X.storage && NULL != X.data.buffer.ptr) { \
+                free(X.data.buffer.ptr); \
+            } \
             X.data.buffer.ptr = 0; \
             X.data.buffer.size = 0; \
         } \
+        X.storage = Storage_Heap; \
+        X.inlineSize = 0; \
     }
 
 namespace sql
 {
-    DBDataCell::DBDataCell()
-        :m_name()
+    DBDataArena::DBDataArena(size_t chunkSize)
+        : m_chunks()
+        , m_chunkSize(chunkSize > 0 ? chunkSize : 1)
+        , m_current(0)
+        , m_offset(0)
+        , m_used(0)
     {
-        // LOGD("DBDataCell::DBDataCell()");
-        memset(&m_cell, 0x00, sizeof(Cell));
     }
 
-    DBDataCell::DBDataCell(const std::string &name)
-        :m_name(name)
+    DBDataArena::DBDataArena(DBDataArena&& x)
+        : m_chunks(std::move(x.m_chunks))
+        , m_chunkSize(x.m_chunkSize)
+        , m_current(x.m_current)
+        , m_offset(x.m_offset)
+        , m_used(x.m_used)
     {
-        memset(&m_cell, 0x00, sizeof(Cell));
+        x.m_chunks.clear();
+        x.reset();
     }
 
-    DBDataCell::DBDataCell(const DBDataCell& x)
-        :m_name()
+    DBDataArena::~DBDataArena()
     {
-        // LOGD("DBDataCell::DBDataCell(const DBDataCell& x)");
-        memcpy(&m_cell, &(x.m_cell), sizeof(Cell));
-        if ((DBDataType_String == m_cell.type || DBDataType_Blob == m_cell.type)
-            && NULL != x.m_cell.data.buffer.ptr) {
-            m_cell.data.buffer.ptr = malloc(m_cell.data.buffer.size);
-            // LOGD("+++malloced %p, size[%u]", m_cell.data.buffer.ptr, m_cell.data.buffer.size);
-            if (NULL != m_cell.data.buffer.ptr) {
-                memcpy(m_cell.data.buffer.ptr,
-                        x.m_cell.data.buffer.ptr,
-                        x.m_cell.data.buffer.size);
+        release();
+    }
+
+    DBDataArena& DBDataArena::operator=(DBDataArena&& x)
+    {
+        if (this != &x) {
+            release();
+
+            m_chunks = std::move(x.m_chunks);
+            m_chunkSize = x.m_chunkSize;
+            m_current = x.m_current;
+            m_offset = x.m_offset;
+            m_used = x.m_used;
+
+            x.m_chunks.clear();
+            x.reset();
+        }
+
+        return *this;
+    }
+
+    void* DBDataArena::allocate(size_t size)
+    {
+        // move on to the next chunk that still fits the request.
+        while (m_current < m_chunks.size()
+               && m_offset + size > m_chunks[m_current].size) {
+            m_current++;
+            m_offset = 0;
+        }
+
+        if (m_current >= m_chunks.size()) {
+            Chunk chunk;
+            chunk.size = size > m_chunkSize ? size : m_chunkSize;
+            chunk.data = (char*)malloc(chunk.size);
+            // LOGD("+++malloced %p, size[%u]", chunk.data, chunk.size);
+            if (NULL == chunk.data) {
+                return NULL;
             }
-            else {
-                // error
-                m_cell.type = DBDataType_Null;
+
+            m_chunks.push_back(chunk);
+            m_current = m_chunks.size() - 1;
+            m_offset = 0;
+        }
+
+        void* ptr = m_chunks[m_current].data + m_offset;
+        m_offset += size;
+        m_used += size;
+
+        return ptr;
+    }
+
+    void DBDataArena::reset()
+    {
+        m_current = 0;
+        m_offset = 0;
+        m_used = 0;
+    }
+
+    void DBDataArena::release()
+    {
+        for (size_t i = 0; i < m_chunks.size(); i++) {
+            free(m_chunks[i].data);
+        }
+
+        m_chunks.clear();
+        reset();
+    }
+
+    size_t DBDataArena::getUsed() const
+    {
+        return m_used;
+    }
+
+    size_t DBDataArena::getCapacity() const
+    {
+        size_t capacity = 0;
+        for (size_t i = 0; i < m_chunks.size(); i++) {
+            capacity += m_chunks[i].size;
+        }
+
+        return capacity;
+    }
+
+    DBDataSchema::DBDataSchema(int columnCount)
+        : m_names(columnCount > 0 ? columnCount : 0)
+        , m_index()
+        , m_columnList()
+        , m_columnListValid(false)
+    {
+    }
+
+    int DBDataSchema::getColumnCount() const
+    {
+        return m_names.size();
+    }
+
+    bool DBDataSchema::setColumnName(int column, const char* name)
+    {
+        if (column < 0 || column >= (int)m_names.size() || NULL == name) {
+            return false;
+        }
+
+        auto it = m_index.find(m_names[column]);
+        if (it != m_index.end() && it->second == column) {
+            m_index.erase(it);
+        }
+
+        m_names[column].assign(name);
+        // the first column with a name wins the lookup.
+        m_index.insert(std::make_pair(m_names[column], column));
+        m_columnListValid = false;
+
+        return true;
+    }
+
+    const std::string& DBDataSchema::getColumnName(int column) const
+    {
+        static const std::string empty;
+
+        if (column < 0 || column >= (int)m_names.size()) {
+            return empty;
+        }
+
+        return m_names[column];
+    }
+
+    int DBDataSchema::getColumnIndex(const std::string& name) const
+    {
+        auto it = m_index.find(name);
+        if (it == m_index.end()) {
+            return -1;
+        }
+
+        return it->second;
+    }
+
+    const std::string& DBDataSchema::getColumnList() const
+    {
+        if (!m_columnListValid) {
+            m_columnList.clear();
+            for (size_t i = 0; i < m_names.size(); i++) {
+                if (i != 0) {
+                    m_columnList.append(", ");
+                }
+                m_columnList.append(m_names[i]);
             }
+            m_columnListValid = true;
         }
+
+        return m_columnList;
+    }
+
+    DBDataCell::DBDataCell()
+        : m_cell()
+    {
+        // LOGD("DBDataCell::DBDataCell()");
+    }
+
+    DBDataCell::DBDataCell(const DBDataCell& x)
+        : m_cell()
+    {
+        // LOGD("DBDataCell::DBDataCell(const DBDataCell& x)");
+        *this = x;
+    }
+
+    DBDataCell::DBDataCell(DBDataCell&& x)
+        : m_cell()
+    {
+        // heap payloads are stolen, arena payloads stay with their arena.
+        *this = std::move(x);
     }
 
     DBDataCell::~DBDataCell()
@@ -65,16 +229,15 @@ namespace sql
 
         if (DBDataType_String == m_cell.type
             || DBDataType_Blob == m_cell.type) {
-            if (m_cell.data.buffer.size != x.m_cell.data.buffer.size) {
+            // inline and out of line payloads compare by content.
+            size_t size = payloadSize();
+            if (size != x.payloadSize()) {
                 return false;
             }
-            if (NULL == m_cell.data.buffer.ptr
-                || NULL == x.m_cell.data.buffer.ptr) {
+            if (NULL == payload() || NULL == x.payload()) {
                 return false;
             }
-            int r = memcmp(m_cell.data.buffer.ptr,
-                    x.m_cell.data.buffer.ptr,
-                    m_cell.data.buffer.size);
+            int r = memcmp(payload(), x.payload(), size);
             if (r) {
                 return false;
             }
@@ -96,120 +259,73 @@ namespace sql
     bool DBDataCell::operator!=(const DBDataCell& x) const
     {
         // LOGD("DBDataCell::operator!=(const DBDataCell& x)");
-        if (m_cell.type != x.m_cell.type) {
-            return true;
-        }
+        return !(*this == x);
+    }
 
-        if (DBDataType_String == m_cell.type
-            || DBDataType_Blob == m_cell.type) {
-            if (m_cell.data.buffer.size != x.m_cell.data.buffer.size) {
-                return true;
-            }
 
-            if (NULL == m_cell.data.buffer.ptr
-                || NULL == x.m_cell.data.buffer.ptr) {
-                return true;
-            }
-            int r = memcmp(m_cell.data.buffer.ptr,
-                    x.m_cell.data.buffer.ptr,
-                    m_cell.data.buffer.size);
-            if (r) {
-                return true;
-            }
-        }
-        else if (DBDataType_Integer == m_cell.type) {
-            if (m_cell.data.l != x.m_cell.data.l) {
-                return true;
-            }
-        }
-        else if (DBDataType_Float == m_cell.type) {
-            if (m_cell.data.d != x.m_cell.data.d) {
-                return true;
+    DBDataCell& DBDataCell::operator=(const DBDataCell& x)
+    {
+        // LOGD("DBDataCell::operator=(const DBDataCell& x)");
+        if (this != &x) {
+            if ((DBDataType_String == x.m_cell.type || DBDataType_Blob == x.m_cell.type)
+                && NULL != x.payload()) {
+                // copies always own their payload, inline when it fits.
+                if (!put(x.m_cell.type, x.payload(), x.payloadSize(), false, NULL)) {
+                    // error
+                    putNull();
+                }
+                return *this;
             }
+
+            DBDATA_CELL_FREE(m_cell);
+            memcpy(&m_cell, &(x.m_cell), sizeof(Cell));
         }
 
-        return false;
+        return *this;
     }
 
-
-    DBDataCell& DBDataCell::operator=(const DBDataCell& x)
+    DBDataCell& DBDataCell::operator=(DBDataCell&& x)
     {
-        // LOGD("DBDataCell::operator=(const DBDataCell& x)");
         if (this != &x) {
+            if (Storage_Arena == x.m_cell.storage) {
+                return *this = static_cast<const DBDataCell&>(x);
+            }
+
             DBDATA_CELL_FREE(m_cell);
 
             memcpy(&m_cell, &(x.m_cell), sizeof(Cell));
-            if ((DBDataType_String == m_cell.type || DBDataType_Blob == m_cell.type)
-                && x.m_cell.data.buffer.ptr) {
-                m_cell.data.buffer.ptr = malloc(m_cell.data.buffer.size);
-                // LOGD("+++malloced %p, size[%u]", m_cell.data.buffer.ptr, m_cell.data.buffer.size);
-                if (NULL != m_cell.data.buffer.ptr) {
-                    memcpy(m_cell.data.buffer.ptr,
-                            x.m_cell.data.buffer.ptr,
-                            x.m_cell.data.buffer.size);
-                }
-                else {
-                    // error
-                    m_cell.type = DBDataType_Null;
-                }
-            }
+            x.m_cell = Cell();
         }
 
         return *this;
     }
 
-    bool DBDataCell::putBlob(const void* value, size_t size)
+    bool DBDataCell::putBlob(const void* value, size_t size, DBDataArena* arena)
     {
         // LOGD("DBDataCell::putBlob");
         if (NULL == value || 0 == size) {
             return false;
         }
 
-        void* temp = malloc(size);
-        // LOGD("+++malloced %p, size[%u]", temp, size);
-        if (NULL == temp) {
-            return false;
-        }
-        memcpy(temp, value, size);
-
-        DBDATA_CELL_FREE(m_cell);
-
-        m_cell.type = DBDataType_Blob;
-        m_cell.data.buffer.ptr = temp;
-        m_cell.data.buffer.size = size;
-
-        return true;
+        return put(DBDataType_Blob, value, size, false, arena);
     }
 
-    bool DBDataCell::putString(const char* value, size_t length)
+    bool DBDataCell::putString(const char* value, size_t length, DBDataArena* arena)
     {
         // LOGD("DBDataCell::putString");
         if (NULL == value || 0 == length) {
             return false;
         }
 
-        int len = strlen(value);
+        size_t len = strlen(value);
         if (len > length) {
             len = length;
         }
-        void* temp = malloc(len + 1);
-        // LOGD("+++malloced %p, size[%u]", temp, len + 1);
-        if (NULL == temp) {
-            return false;
-        }
-        memset(temp, 0x00, len + 1);
-        memcpy(temp, value, len);
-
-        DBDATA_CELL_FREE(m_cell);
-
-        m_cell.type = DBDataType_String;
-        m_cell.data.buffer.ptr = temp;
-        m_cell.data.buffer.size = len + 1;
 
-        return true;
+        return put(DBDataType_String, value, len, true, arena);
     }
 
-    bool DBDataCell::putLong(int value)
+    bool DBDataCell::putLong(int64_t value)
     {
         // LOGD("DBDataCell::putLong(%lld)", value);
         DBDATA_CELL_FREE(m_cell);
@@ -247,7 +363,7 @@ namespace sql
         return m_cell.type;
     }
 
-    int DBDataCell::getLong() const
+    int64_t DBDataCell::getLong() const
     {
         // LOGD("DBDataCell::getLong");
         if (m_cell.type == DBDataType_Integer) {
@@ -273,14 +389,15 @@ namespace sql
     {
         // LOGD("DBDataCell::getString");
         if (m_cell.type == DBDataType_String) {
-            if (0 < m_cell.data.buffer.size) {
-                length = m_cell.data.buffer.size - 1;
+            size_t size = payloadSize();
+            if (0 < size) {
+                length = size - 1;
             }
             else {
-                length = m_cell.data.buffer.size;
+                length = size;
             }
-            // LOGD("cell data is [%s]", (char*)m_cell.data.buffer.ptr);
-            return (char*)m_cell.data.buffer.ptr;
+            // LOGD("cell data is [%s]", (const char*)payload());
+            return (const char*)payload();
         }
 
         return NULL;
@@ -290,17 +407,73 @@ namespace sql
     {
         // LOGD("DBDataCell::getBlob");
         if (m_cell.type == DBDataType_Blob) {
-            outSize = m_cell.data.buffer.size;
-            // LOGD("cell data is %p, size is %zu", m_cell.data.buffer.ptr, outSize);
-            return m_cell.data.buffer.ptr;
+            outSize = payloadSize();
+            // LOGD("cell data is %p, size is %zu", payload(), outSize);
+            return payload();
         }
 
         return NULL;
     }
 
-    DBDataRow::DBDataRow(int columount)
+    bool DBDataCell::put(DBDataType type, const void* value, size_t size, bool terminate, DBDataArena* arena)
+    {
+        size_t total = terminate ? size + 1 : size;
+
+        // value may point into the current payload, copy before freeing it.
+        char local[sizeof(m_cell.data.local)];
+        void* temp = local;
+        if (total > sizeof(local)) {
+            temp = arena ? arena->allocate(total) : malloc(total);
+            // LOGD("+++malloced %p, size[%u]", temp, total);
+            if (NULL == temp) {
+                return false;
+            }
+        }
+        memcpy(temp, value, size);
+        if (terminate) {
+            ((char*)temp)[size] = '\0';
+        }
+
+        DBDATA_CELL_FREE(m_cell);
+
+        m_cell.type = type;
+        if (temp == local) {
+            m_cell.storage = Storage_Inline;
+            m_cell.inlineSize = total;
+            memcpy(m_cell.data.local, local, total);
+        }
+        else {
+            m_cell.storage = arena ? Storage_Arena : Storage_Heap;
+            m_cell.data.buffer.ptr = temp;
+            m_cell.data.buffer.size = total;
+        }
+
+        return true;
+    }
+
+    const void* DBDataCell::payload() const
+    {
+        if (Storage_Inline == m_cell.storage) {
+            return m_cell.data.local;
+        }
+
+        return m_cell.data.buffer.ptr;
+    }
+
+    size_t DBDataCell::payloadSize() const
+    {
+        if (Storage_Inline == m_cell.storage) {
+            return m_cell.inlineSize;
+        }
+
+        return m_cell.data.buffer.size;
+    }
+
+    DBDataRow::DBDataRow(int columount, DBDataArena* arena)
           : m_count(columount)
           , m_cells(NULL)
+          , m_arena(arena)
+          , m_schema()
     {
         // LOGD("DBDataRow::DBDataRow(%u)", columount);
         if (m_count > 0) {
@@ -312,9 +485,22 @@ namespace sql
         }
     }
 
+    DBDataRow::DBDataRow(const std::shared_ptr<DBDataSchema>& schema, DBDataArena* arena)
+          : m_count(schema ? schema->getColumnCount() : 0)
+          , m_cells(NULL)
+          , m_arena(arena)
+          , m_schema(schema)
+    {
+        if (m_count > 0) {
+            m_cells = new DBDataCell[m_count];
+        }
+    }
+
     DBDataRow::DBDataRow(const DBDataRow& x)
           : m_count(x.m_count)
           , m_cells(NULL)
+          , m_arena(NULL)
+          , m_schema(x.m_schema)
     {
         // LOGD("DBDataRow::DBDataRow(const DBDataRow& x)");
         if (m_count > 0 && NULL != x.m_cells) {
@@ -334,6 +520,16 @@ namespace sql
         }
     }
 
+    DBDataRow::DBDataRow(DBDataRow&& x)
+          : m_count(x.m_count)
+          , m_cells(x.m_cells)
+          , m_arena(x.m_arena)
+          , m_schema(std::move(x.m_schema))
+    {
+        x.m_count = 0;
+        x.m_cells = NULL;
+    }
+
     DBDataRow::~DBDataRow()
     {
         // LOGD("DBDataRow::~DBDataRow()");
@@ -371,6 +567,7 @@ namespace sql
             }
 
             m_count = x.m_count;
+            m_schema = x.m_schema;
             if (m_count > 0) {
                 m_cells = new DBDataCell[m_count];
                 for (int i = 0; i < m_count; i++) {
@@ -382,6 +579,25 @@ namespace sql
         return *this;
     }
 
+    DBDataRow& DBDataRow::operator=(DBDataRow&& x)
+    {
+        if (this != &x) {
+            if (m_cells) {
+                delete[] m_cells;
+            }
+
+            m_count = x.m_count;
+            m_cells = x.m_cells;
+            m_arena = x.m_arena;
+            m_schema = std::move(x.m_schema);
+
+            x.m_count = 0;
+            x.m_cells = NULL;
+        }
+
+        return *this;
+    }
+
     int DBDataRow::getColumnCount() const
     {
         // LOGD("column count is %u", m_count);
@@ -414,10 +630,10 @@ namespace sql
         }
 
         if (name != NULL) {
-            m_cells[index].setName(name);
+            setColumnName(index, name);
         }
 
-        return m_cells[index].putBlob(value, size);
+        return m_cells[index].putBlob(value, size, m_arena);
     }
 
     bool DBDataRow::putString(int index, const char* value, size_t length, const char* name)
@@ -432,13 +648,13 @@ namespace sql
         }
 
         if (name != NULL) {
-            m_cells[index].setName(name);
+            setColumnName(index, name);
         }
 
-        return m_cells[index].putString(value, length);
+        return m_cells[index].putString(value, length, m_arena);
     }
 
-    bool DBDataRow::putLong(int index, int value, const char* name)
+    bool DBDataRow::putLong(int index, int64_t value, const char* name)
     {
         // LOGD("DBDataRow::putLong(index=%u, value=%lld)", index, value);
         if (index >= m_count) {
@@ -450,7 +666,7 @@ namespace sql
         }
 
         if (name != NULL) {
-            m_cells[index].setName(name);
+            setColumnName(index, name);
         }
 
         return m_cells[index].putLong(value);
@@ -468,7 +684,7 @@ namespace sql
         }
 
         if (name != NULL) {
-            m_cells[index].setName(name);
+            setColumnName(index, name);
         }
 
         return m_cells[index].putDouble(value);
@@ -486,13 +702,13 @@ namespace sql
         }
 
         if (name != NULL) {
-            m_cells[index].setName(name);
+            setColumnName(index, name);
         }
 
         return m_cells[index].putNull();
     }
 
-    int DBDataRow::getLong(int index) const
+    int64_t DBDataRow::getLong(int index) const
     {
         // LOGD("DBDataRow::getLong(index=%u)", index);
         if (index >= m_count) {
@@ -550,17 +766,51 @@ namespace sql
 
     const std::string& DBDataRow::getColumnName(int index) const
     {
-        if (index < m_count) {
-            return m_cells[index].getName();
+        static const std::string empty;
+
+        if (index < m_count && m_schema) {
+            return m_schema->getColumnName(index);
+        }
+
+        return empty;
+    }
+
+    int DBDataRow::getColumnIndex(const std::string& name) const
+    {
+        if (!m_schema) {
+            return -1;
+        }
+
+        return m_schema->getColumnIndex(name);
+    }
+
+    const DBDataSchema* DBDataRow::getSchema() const
+    {
+        return m_schema.get();
+    }
+
+    void DBDataRow::setColumnName(int index, const char* name)
+    {
+        if (!m_schema) {
+            m_schema = std::make_shared<DBDataSchema>(m_count);
+        }
+        else if (m_schema->getColumnName(index) == name) {
+            return;
+        }
+        else if (m_schema.use_count() != 1) {
+            // copy on write, other rows keep the old names.
+            m_schema = std::make_shared<DBDataSchema>(*m_schema);
         }
 
-        return "";
+        m_schema->setColumnName(index, name);
     }
 
     DBDataTable::DBDataTable(int columount)
           : m_rowSpList()
           , m_columnCount(columount)
           , m_columnTypes(NULL)
+          , m_schema(std::make_shared<DBDataSchema>(columount))
+          , m_arena()
     {
         // LOGD("DBDataTable::DBDataTable(%u)", columount);
         if (columount > 0) {
@@ -576,6 +826,8 @@ namespace sql
           : m_rowSpList()
           , m_columnCount(columount)
           , m_columnTypes(NULL)
+          , m_schema(std::make_shared<DBDataSchema>(columount))
+          , m_arena()
     {
         // LOGD("DBDataTable::DBDataTable(%u, %u)", rowCount, columount);
         if (columount > 0) {
@@ -589,12 +841,58 @@ namespace sql
         m_rowSpList.resize(rowCount, NULL);
     }
 
+    DBDataTable::DBDataTable(DBDataTable&& x)
+          : m_rowSpList(std::move(x.m_rowSpList))
+          , m_columnCount(x.m_columnCount)
+          , m_columnTypes(x.m_columnTypes)
+          , m_schema(std::move(x.m_schema))
+          , m_arena(std::move(x.m_arena))
+    {
+        // rows follow their payloads into the new arena.
+        for (size_t i = 0; i < m_rowSpList.size(); i++) {
+            if (m_rowSpList[i]) {
+                m_rowSpList[i]->m_arena = &m_arena;
+            }
+        }
+
+        x.m_rowSpList.clear();
+        x.m_columnCount = 0;
+        x.m_columnTypes = NULL;
+        x.m_schema = std::make_shared<DBDataSchema>(0);
+    }
+
     DBDataTable::~DBDataTable()
     {
         // LOGD("DBDataTable::~DBDataTable()");
         reset();
     }
 
+    DBDataTable& DBDataTable::operator=(DBDataTable&& x)
+    {
+        if (this != &x) {
+            reset();
+
+            m_rowSpList = std::move(x.m_rowSpList);
+            m_columnCount = x.m_columnCount;
+            m_columnTypes = x.m_columnTypes;
+            m_schema = std::move(x.m_schema);
+            m_arena = std::move(x.m_arena);
+
+            for (size_t i = 0; i < m_rowSpList.size(); i++) {
+                if (m_rowSpList[i]) {
+                    m_rowSpList[i]->m_arena = &m_arena;
+                }
+            }
+
+            x.m_rowSpList.clear();
+            x.m_columnCount = 0;
+            x.m_columnTypes = NULL;
+            x.m_schema = std::make_shared<DBDataSchema>(0);
+        }
+
+        return *this;
+    }
+
     bool DBDataTable::setRowCount(int rowCount)
     {
         // LOGD("DBDataTable::setRowCount(%u)", rowCount);
@@ -602,12 +900,23 @@ namespace sql
         return true;
     }
 
-    int DBDataTable::getRowCount()
+    int DBDataTable::getRowCount() const
     {
         // LOGD("row count is %u", m_rowSpList.size());
         return m_rowSpList.size();
     }
 
+    size_t DBDataTable::getMemoryUsage() const
+    {
+        // table payloads live in the arena, rows and cells have a fixed size.
+        size_t rowSize = sizeof(DBDataRow) + m_columnCount * sizeof(DBDataCell);
+
+        return sizeof(*this) + m_arena.getCapacity()
+               + m_columnCount * sizeof(DBDataType)
+               + m_rowSpList.capacity() * sizeof(DBDataRow*)
+               + m_rowSpList.size() * rowSize;
+    }
+
     bool DBDataTable::setColumnCount(int columount)
     {
         // LOGD("DBDataTable::setColumount(%u)", columount);
@@ -617,6 +926,7 @@ namespace sql
 
         m_columnCount = columount;
         if (columount > 0) {
+            m_schema = std::make_shared<DBDataSchema>(columount);
             m_columnTypes = (DBDataType*)malloc(sizeof(DBDataType) * columount);
             // LOGD("+++malloced %p, size[%u]", m_columnTypes, sizeof(DBDataType) * columount);
             for (int i = 0; i < columount; i++) {
@@ -626,7 +936,7 @@ namespace sql
         return true;
     }
 
-    int DBDataTable::getColumnCount()
+    int DBDataTable::getColumnCount() const
     {
         // LOGD("column count is %u", m_columnCount);
         return m_columnCount;
@@ -648,7 +958,7 @@ namespace sql
         return true;
     }
 
-    DBDataType DBDataTable::getColumnType(int column)
+    DBDataType DBDataTable::getColumnType(int column) const
     {
         // LOGD("DBDataTable::getColumnType(column=%u)", column);
         if (NULL != m_columnTypes && column < m_columnCount) {
@@ -660,9 +970,36 @@ namespace sql
         }
     }
 
+    bool DBDataTable::setColumnName(int column, const char* name)
+    {
+        if (column >= m_columnCount || NULL == name) {
+            return false;
+        }
+
+        return m_schema->setColumnName(column, name);
+    }
+
+    const std::string& DBDataTable::getColumnName(int column) const
+    {
+        return m_schema->getColumnName(column);
+    }
+
+    int DBDataTable::getColumnIndex(const std::string& name) const
+    {
+        return m_schema->getColumnIndex(name);
+    }
+
+    const DBDataSchema* DBDataTable::getSchema() const
+    {
+        return m_schema.get();
+    }
+
     bool DBDataTable::reset()
     {
         // LOGD("DBDataTable::reset");
+        for (size_t i = 0; i < m_rowSpList.size(); i++) {
+            delete m_rowSpList[i];
+        }
         m_rowSpList.resize(0);
 
         if (m_columnTypes) {
@@ -670,6 +1007,11 @@ namespace sql
             // LOGD("---free %p, size[%u]", m_columnTypes, sizeof(DBDataType) * m_columnCount);
             m_columnTypes = NULL;
         }
+        m_columnCount = 0;
+        m_schema = std::make_shared<DBDataSchema>(0);
+
+        // every payload is gone with the rows, rewind for the next fill.
+        m_arena.reset();
 
         return true;
     }
@@ -680,6 +1022,15 @@ namespace sql
         m_rowSpList.resize(m_rowSpList.size() + 1);
     }
 
+    const DBDataRow* DBDataTable::getRow(int row) const
+    {
+        if (row < 0 || row >= (int)m_rowSpList.size()) {
+            return NULL;
+        }
+
+        return m_rowSpList[row];
+    }
+
     bool DBDataTable::putBlob(int row, int column, const void* value, size_t size)
     {
         // LOGD("DBDataTable::putBlob(row=%u, column=%u, value=%p, size=%zu)", row, column, value, size);
@@ -696,7 +1047,7 @@ namespace sql
         }
 
         if (NULL == m_rowSpList[row]) {
-            m_rowSpList[row] = new DBDataRow(m_columnCount);
+            m_rowSpList[row] = new DBDataRow(m_schema, &m_arena);
             if (NULL == m_rowSpList[row]) {
                 return false;
             }
@@ -721,7 +1072,7 @@ namespace sql
         }
 
         if (NULL == m_rowSpList[row]) {
-            m_rowSpList[row] = new DBDataRow(m_columnCount);
+            m_rowSpList[row] = new DBDataRow(m_schema, &m_arena);
             if (NULL == m_rowSpList[row]) {
                 return false;
             }
@@ -730,7 +1081,7 @@ namespace sql
         return m_rowSpList[row]->putString(column, value, size);
     }
 
-    bool DBDataTable::putLong(int row, int column, int value)
+    bool DBDataTable::putLong(int row, int column, int64_t value)
     {
         // LOGD("DBDataTable::putLong(row=%u, column=%u, value=%lld)", row, column, value);
         if (row >= m_rowSpList.size() || column >= m_columnCount) {
@@ -743,7 +1094,7 @@ namespace sql
         }
 
         if (NULL == m_rowSpList[row]) {
-            m_rowSpList[row] = new DBDataRow(m_columnCount);
+            m_rowSpList[row] = new DBDataRow(m_schema, &m_arena);
             if (NULL == m_rowSpList[row]) {
                 return false;
             }
@@ -765,7 +1116,7 @@ namespace sql
         }
 
         if (NULL == m_rowSpList[row]) {
-            m_rowSpList[row] = new DBDataRow(m_columnCount);
+            m_rowSpList[row] = new DBDataRow(m_schema, &m_arena);
             if (NULL == m_rowSpList[row]) {
                 return false;
             }
@@ -782,7 +1133,7 @@ namespace sql
         }
 
         if (NULL == m_rowSpList[row]) {
-            m_rowSpList[row] = new DBDataRow(m_columnCount);
+            m_rowSpList[row] = new DBDataRow(m_schema, &m_arena);
             if (NULL == m_rowSpList[row]) {
                 return false;
             }
@@ -791,7 +1142,7 @@ namespace sql
         return m_rowSpList[row]->putNull(column);
     }
 
-    DBDataType DBDataTable::getType(int row, int column)
+    DBDataType DBDataTable::getType(int row, int column) const
     {
         // LOGD("DBDataTable::getType(row=%u, column=%u)", row, column);
         if (row >= m_rowSpList.size() || column >= m_columnCount) {
@@ -805,7 +1156,7 @@ namespace sql
         return m_rowSpList[row]->type(column);
     }
 
-    int DBDataTable::getLong(int row, int column)
+    int64_t DBDataTable::getLong(int row, int column) const
     {
         // LOGD("DBDataTable::getLong(row=%u, column=%u)", row, column);
         if (row >= m_rowSpList.size() || column >= m_columnCount) {
@@ -823,7 +1174,7 @@ namespace sql
         return 0;
     }
 
-    double DBDataTable::getDouble(int row, int column)
+    double DBDataTable::getDouble(int row, int column) const
     {
         // LOGD("DBDataTable::getdouble(row=%u, column=%u)", row, column);
         if (row >= m_rowSpList.size() || column >= m_columnCount) {
@@ -841,7 +1192,7 @@ namespace sql
         return 0;
     }
 
-    const char* DBDataTable::getString(int row, int column, size_t& length)
+    const char* DBDataTable::getString(int row, int column, size_t& length) const
     {
         // LOGD("DBDataTable::getString(row=%u, column=%u)", row, column);
         if (row >= m_rowSpList.size() || column >= m_columnCount) {
@@ -859,7 +1210,7 @@ namespace sql
         return NULL;
     }
 
-    const void* DBDataTable::getBlob(int row, int column, size_t& size)
+    const void* DBDataTable::getBlob(int row, int column, size_t& size) const
     {
         // LOGD("DBDataTable::getBlob(row=%u, column=%u)", row, column);
         if (row >= m_rowSpList.size() || column >= m_columnCount) {
@@ -0,0 +1,175 @@
+#include <time.h>
+#include <atomic>
+
+#include "database_log.h"
+
+namespace sql
+{
+    static std::mutex g_sinkMutex;
+    static std::shared_ptr<DBLogSink> g_sink(new DBStreamLogSink(stderr));
+    static std::atomic<int> g_level(DBLogLevel_Warn);
+
+    DBStreamLogSink::DBStreamLogSink(FILE* stream)
+        : m_stream(stream)
+    {
+    }
+
+    void DBStreamLogSink::write(const DBLogRecord& record)
+    {
+        std::string text = line(record);
+        // one fwrite per line keeps lines of concurrent writers apart.
+        fwrite(text.data(), 1, text.size(), m_stream);
+        fflush(m_stream);
+    }
+
+    std::string DBStreamLogSink::line(const DBLogRecord& record)
+    {
+        static const char levels[] = "DIWEN";
+
+        time_t seconds = std::chrono::system_clock::to_time_t(record.time);
+        int millis = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    record.time.time_since_epoch()).count() % 1000);
+        struct tm local;
+        localtime_r(&seconds, &local);
+
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d.%03d %c/",
+                 local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                 local.tm_hour, local.tm_min, local.tm_sec, millis,
+                 levels[record.level]);
+
+        std::string text(prefix);
+        text.append(record.tag ? record.tag : "");
+        text.append(": ");
+        if (record.format) {
+            text.append(record.format());
+        }
+        text.append("\n");
+
+        return text;
+    }
+
+    DBAsyncLogSink::DBAsyncLogSink(const std::shared_ptr<DBLogSink>& target, size_t capacity)
+        : m_target(target)
+        , m_capacity(capacity > 0 ? capacity : 1)
+        , m_mutex()
+        , m_wake()
+        , m_idle()
+        , m_queue()
+        , m_busy(false)
+        , m_stopping(false)
+        , m_dropped(0)
+        , m_thread()
+    {
+        m_thread = std::thread(&DBAsyncLogSink::run, this);
+    }
+
+    DBAsyncLogSink::~DBAsyncLogSink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    void DBAsyncLogSink::write(const DBLogRecord& record)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.size() >= m_capacity) {
+                m_dropped++;
+                return;
+            }
+            m_queue.push_back(record);
+        }
+        m_wake.notify_one();
+    }
+
+    void DBAsyncLogSink::flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_queue.empty() || m_busy) {
+            m_idle.wait(lock);
+        }
+    }
+
+    uint64_t DBAsyncLogSink::getDropped() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_dropped;
+    }
+
+    void DBAsyncLogSink::run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            while (m_queue.empty() && !m_stopping) {
+                m_wake.wait(lock);
+            }
+            // drain what is left before stopping.
+            if (m_queue.empty()) {
+                break;
+            }
+
+            DBLogRecord record = m_queue.front();
+            m_queue.pop_front();
+            m_busy = true;
+            lock.unlock();
+
+            if (m_target) {
+                m_target->write(record);
+            }
+
+            lock.lock();
+            m_busy = false;
+            if (m_queue.empty()) {
+                m_idle.notify_all();
+            }
+        }
+    }
+
+    void DBLog::setSink(const std::shared_ptr<DBLogSink>& sink)
+    {
+        std::lock_guard<std::mutex> lock(g_sinkMutex);
+        g_sink = sink;
+    }
+
+    void DBLog::setLevel(DBLogLevel level)
+    {
+        g_level.store(level, std::memory_order_relaxed);
+    }
+
+    DBLogLevel DBLog::getLevel()
+    {
+        return static_cast<DBLogLevel>(g_level.load(std::memory_order_relaxed));
+    }
+
+    bool DBLog::isEnabled(DBLogLevel level)
+    {
+        return (level < DBLogLevel_None && level >= g_level.load(std::memory_order_relaxed));
+    }
+
+    void DBLog::write(DBLogLevel level, const char* tag, const std::function<std::string()>& format)
+    {
+        std::shared_ptr<DBLogSink> sink;
+        {
+            std::lock_guard<std::mutex> lock(g_sinkMutex);
+            sink = g_sink;
+        }
+        if (!sink) {
+            return;
+        }
+
+        DBLogRecord record;
+        record.level = level;
+        record.tag = tag;
+        record.time = std::chrono::system_clock::now();
+        record.format = format;
+
+        sink->write(record);
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,225 @@
+#include <chrono>
+#include <cstring>
+
+#include "database_pool.h"
+
+#define LOG_TAG "dbhelper"
+#include "database_log.h"
+
+namespace sql
+{
+    static void recordLease(DBLeaseStats& stats, bool waited, uint64_t waitNs)
+    {
+        stats.leases++;
+        if (waited) {
+            stats.waits++;
+            stats.totalWaitNs += waitNs;
+            if (waitNs > stats.maxWaitNs) {
+                stats.maxWaitNs = waitNs;
+            }
+        }
+    }
+
+    DatabasePool::Lease::Lease()
+        : m_pool(NULL)
+        , m_db(NULL)
+    {
+    }
+
+    DatabasePool::Lease::Lease(DatabasePool* pool, database* db)
+        : m_pool(pool)
+        , m_db(db)
+    {
+    }
+
+    DatabasePool::Lease::Lease(Lease&& x)
+        : m_pool(x.m_pool)
+        , m_db(x.m_db)
+    {
+        x.m_pool = NULL;
+        x.m_db = NULL;
+    }
+
+    DatabasePool::Lease::~Lease()
+    {
+        release();
+    }
+
+    DatabasePool::Lease& DatabasePool::Lease::operator=(Lease&& x)
+    {
+        if (this != &x) {
+            release();
+
+            m_pool = x.m_pool;
+            m_db = x.m_db;
+            x.m_pool = NULL;
+            x.m_db = NULL;
+        }
+
+        return *this;
+    }
+
+    void DatabasePool::Lease::release()
+    {
+        if (m_pool && m_db) {
+            m_pool->giveBack(m_db);
+        }
+
+        m_pool = NULL;
+        m_db = NULL;
+    }
+
+    DatabasePool::DatabasePool(const std::string& path, int readers, const void* pKey, int nKey)
+        : m_path(path)
+        , m_writer(NULL)
+        , m_readers()
+        , m_mutex()
+        , m_readerAvailable()
+        , m_writerAvailable()
+        , m_freeReaders()
+        , m_writerFree(false)
+    {
+        memset(&m_stats, 0, sizeof(m_stats));
+
+        // the writer creates the file and switches it to WAL before any reader opens it.
+        m_writer = new database(path, pKey, nKey);
+        if (!m_writer->isOpen()) {
+            return;
+        }
+
+        // the pragma answers with the mode in effect, ":memory:" stays "memory" without an error.
+        std::unique_ptr<DBDataTable> mode = m_writer->rawQuery("PRAGMA journal_mode=WAL", std::vector<std::string>());
+        size_t length = 0;
+        const char* name = (mode && mode->getRowCount() > 0) ? mode->getString(0, 0, length) : NULL;
+        if (name == NULL || strcmp(name, "wal") != 0) {
+            LOGE("pool needs WAL, journal mode is %s: %s", name ? name : "unknown", path.c_str());
+            delete m_writer;
+            m_writer = NULL;
+            return;
+        }
+        m_writerFree = true;
+
+        for (int i = 0; i < readers; i++) {
+            database* reader = new database(path, pKey, nKey, true);
+            if (!reader->isOpen()) {
+                delete reader;
+                continue;
+            }
+
+            m_readers.push_back(reader);
+            m_freeReaders.push_back(reader);
+        }
+    }
+
+    DatabasePool::~DatabasePool()
+    {
+        // all leases must have been released by now.
+        for (size_t i = 0; i < m_readers.size(); i++) {
+            delete m_readers[i];
+        }
+
+        delete m_writer;
+    }
+
+    bool DatabasePool::isOpen() const
+    {
+        return (m_writer != NULL && m_writer->isOpen());
+    }
+
+    int DatabasePool::getReaderCount() const
+    {
+        return m_readers.size();
+    }
+
+    DatabasePool::Lease DatabasePool::acquireReader(int timeoutMs)
+    {
+        if (m_readers.empty()) {
+            // no read connection could be opened, share the writer.
+            return acquireWriter(timeoutMs);
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        bool waited = m_freeReaders.empty();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        if (timeoutMs < 0) {
+            while (m_freeReaders.empty()) {
+                m_readerAvailable.wait(lock);
+            }
+        }
+        else if (!m_readerAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                             [this] { return !m_freeReaders.empty(); })) {
+            m_stats.reader.timeouts++;
+            return Lease();
+        }
+
+        uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        recordLease(m_stats.reader, waited, waitNs);
+
+        database* db = m_freeReaders.back();
+        m_freeReaders.pop_back();
+
+        return Lease(this, db);
+    }
+
+    DatabasePool::Lease DatabasePool::acquireWriter(int timeoutMs)
+    {
+        if (!isOpen()) {
+            return Lease();
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        bool waited = !m_writerFree;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        if (timeoutMs < 0) {
+            while (!m_writerFree) {
+                m_writerAvailable.wait(lock);
+            }
+        }
+        else if (!m_writerAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                             [this] { return m_writerFree; })) {
+            m_stats.writer.timeouts++;
+            return Lease();
+        }
+
+        uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        recordLease(m_stats.writer, waited, waitNs);
+
+        m_writerFree = false;
+
+        return Lease(this, m_writer);
+    }
+
+    DBPoolStats DatabasePool::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void DatabasePool::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
+
+    void DatabasePool::giveBack(database* db)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (db == m_writer) {
+            m_writerFree = true;
+            m_writerAvailable.notify_one();
+        }
+        else {
+            m_freeReaders.push_back(db);
+            m_readerAvailable.notify_one();
+        }
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,138 @@
+#include "database_statement.h"
+#include "sqlite3.h"
+
+#define LOG_TAG "dbhelper"
+#include "database_log.h"
+
+namespace sql
+{
+    DBStatementCache::DBStatementCache(sqlite3* handle, size_t capacity)
+        : m_handle(handle)
+        , m_capacity(capacity)
+        , m_entries()
+        , m_index()
+        , m_hits(0)
+        , m_misses(0)
+        , m_evictions(0)
+    {
+    }
+
+    DBStatementCache::~DBStatementCache()
+    {
+        clear();
+    }
+
+    sqlite3_stmt* DBStatementCache::acquire(const std::string& sql, int* err)
+    {
+        auto it = m_index.find(sql);
+        if (it != m_index.end()) {
+            sqlite3_stmt* stmt = it->second->second;
+            m_entries.erase(it->second);
+            m_index.erase(it);
+            m_hits++;
+
+            if (err) {
+                *err = SQLITE_OK;
+            }
+            return stmt;
+        }
+
+        m_misses++;
+
+        sqlite3_stmt* stmt = NULL;
+        int result = sqlite3_prepare_v2(m_handle, sql.data(), sql.length(), &stmt, NULL);
+        if (err) {
+            *err = result;
+        }
+
+        if (result != SQLITE_OK) {
+            LOGE("prepare failed: %s: %s", sqlite3_errmsg(m_handle), sql.c_str());
+            // prepare may still hand back a statement on error.
+            sqlite3_finalize(stmt);
+            return NULL;
+        }
+
+        return stmt;
+    }
+
+    void DBStatementCache::release(const std::string& sql, sqlite3_stmt* stmt)
+    {
+        if (NULL == stmt) {
+            return;
+        }
+
+        if (0 == m_capacity) {
+            sqlite3_finalize(stmt);
+            return;
+        }
+
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+
+        evict(m_capacity - 1);
+
+        m_entries.push_front(Entry(sql, stmt));
+        m_index.insert(std::make_pair(sql, m_entries.begin()));
+    }
+
+    void DBStatementCache::setCapacity(size_t capacity)
+    {
+        m_capacity = capacity;
+        evict(m_capacity);
+    }
+
+    size_t DBStatementCache::getCapacity() const
+    {
+        return m_capacity;
+    }
+
+    void DBStatementCache::clear()
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); it++) {
+            sqlite3_finalize(it->second);
+        }
+
+        m_entries.clear();
+        m_index.clear();
+    }
+
+    DBStatementCacheStats DBStatementCache::getStats() const
+    {
+        DBStatementCacheStats stats;
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        stats.evictions = m_evictions;
+        stats.size = m_entries.size();
+        stats.capacity = m_capacity;
+
+        return stats;
+    }
+
+    void DBStatementCache::resetStats()
+    {
+        m_hits = 0;
+        m_misses = 0;
+        m_evictions = 0;
+    }
+
+    void DBStatementCache::evict(size_t capacity)
+    {
+        while (m_entries.size() > capacity) {
+            EntryList::iterator last = --m_entries.end();
+
+            auto range = m_index.equal_range(last->first);
+            for (auto it = range.first; it != range.second; it++) {
+                if (it->second == last) {
+                    m_index.erase(it);
+                    break;
+                }
+            }
+
+            sqlite3_finalize(last->second);
+            m_entries.erase(last);
+            m_evictions++;
+        }
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "database_stats.h"
+#include "sqlite3.h"
+
+#define LOG_TAG "dbhelper"
+#include "database_log.h"
+
+namespace sql
+{
+    DBSlowQueryLog::DBSlowQueryLog()
+        : m_thresholdNs(-1)
+        , m_redact(false)
+        , m_handler(&DBSlowQueryLog::print)
+    {
+    }
+
+    void DBSlowQueryLog::setThreshold(int thresholdMs)
+    {
+        m_thresholdNs = (thresholdMs < 0) ? -1 : static_cast<int64_t>(thresholdMs) * 1000000;
+    }
+
+    bool DBSlowQueryLog::isEnabled() const
+    {
+        return (m_thresholdNs >= 0);
+    }
+
+    void DBSlowQueryLog::setRedaction(bool redact)
+    {
+        m_redact = redact;
+    }
+
+    void DBSlowQueryLog::setHandler(const DBSlowQueryHandler& handler)
+    {
+        m_handler = handler ? handler : DBSlowQueryHandler(&DBSlowQueryLog::print);
+    }
+
+    void DBSlowQueryLog::check(sqlite3* handle, sqlite3_stmt* stmt, Clock::time_point start) const
+    {
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        if (m_thresholdNs < 0 || ns < m_thresholdNs || NULL == stmt) {
+            return;
+        }
+
+        DBSlowQuery query;
+        query.elapsedNs = ns;
+
+        const char* text = sqlite3_sql(stmt);
+        if (m_redact) {
+            // literals written into the SQL are values too.
+            query.sql = DBQueryStats::normalize(text);
+        }
+        else {
+            char* expanded = sqlite3_expanded_sql(stmt);
+            query.sql = expanded ? expanded : (text ? text : "");
+            sqlite3_free(expanded);
+        }
+
+        query.fullScan = explain(handle, text, query.plan);
+
+        m_handler(query);
+    }
+
+    bool DBSlowQueryLog::explain(sqlite3* handle, const char* sql, std::vector<std::string>& plan)
+    {
+        plan.clear();
+        if (NULL == sql) {
+            return false;
+        }
+
+        std::string explainSql("EXPLAIN QUERY PLAN ");
+        explainSql.append(sql);
+
+        sqlite3_stmt* stmt = NULL;
+        if (sqlite3_prepare_v2(handle, explainSql.c_str(), explainSql.length(), &stmt, NULL) != SQLITE_OK) {
+            sqlite3_finalize(stmt);
+            return false;
+        }
+
+        // parameters are left NULL, the plan does not depend on them.
+        bool fullScan = false;
+        int detail = sqlite3_column_count(stmt) - 1;
+        while (detail >= 0 && sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* line = reinterpret_cast<const char*>(sqlite3_column_text(stmt, detail));
+            std::string text(line ? line : "");
+
+            // "SCAN T" or "SCAN TABLE T", an index scan names its index.
+            if (text.compare(0, 5, "SCAN ") == 0
+                && text.find(" INDEX") == std::string::npos
+                && text.find("CONSTANT ROW") == std::string::npos) {
+                fullScan = true;
+            }
+            plan.push_back(text);
+        }
+        sqlite3_finalize(stmt);
+
+        return fullScan;
+    }
+
+    void DBSlowQueryLog::print(const DBSlowQuery& query)
+    {
+        std::string plan;
+        for (size_t i = 0; i < query.plan.size(); i++) {
+            plan.append(i ? "; " : "");
+            plan.append(query.plan[i]);
+        }
+
+        LOGW("slow query %llu us%s: %s [plan: %s]", static_cast<unsigned long long>(query.elapsedNs / 1000),
+             query.fullScan ? " (full scan)" : "", query.sql.c_str(), plan.c_str());
+    }
+
+    DBQueryStats::Totals::Totals()
+        : count(0)
+        , totalNs(0)
+        , minNs(0)
+        , maxNs(0)
+        , rowsReturned(0)
+        , rowsChanged(0)
+    {
+        memset(buckets, 0, sizeof(buckets));
+    }
+
+    void DBQueryStats::Totals::add(uint64_t ns, uint64_t rows, uint64_t changes)
+    {
+        if (0 == count || ns < minNs) {
+            minNs = ns;
+        }
+        if (ns > maxNs) {
+            maxNs = ns;
+        }
+        count++;
+        totalNs += ns;
+        rowsReturned += rows;
+        rowsChanged += changes;
+
+        // bucket = 4 * log2(ns) + the two bits below the leading one.
+        int bucket = 0;
+        if (ns >= 4) {
+            int log = 63 - __builtin_clzll(ns);
+            bucket = log * 4 + static_cast<int>((ns >> (log - 2)) & 3);
+        }
+        else {
+            bucket = static_cast<int>(ns);
+        }
+        if (bucket >= BucketCount) {
+            bucket = BucketCount - 1;
+        }
+        buckets[bucket]++;
+    }
+
+    uint64_t DBQueryStats::Totals::percentile(double q) const
+    {
+        if (0 == count) {
+            return 0;
+        }
+
+        uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BucketCount; i++) {
+            seen += buckets[i];
+            if (seen < rank) {
+                continue;
+            }
+
+            // upper bound of the bucket, clamped to what was observed.
+            uint64_t bound = static_cast<uint64_t>(i);
+            if (i >= 8) {
+                int log = i / 4;
+                bound = (static_cast<uint64_t>(4 + i % 4 + 1) << (log - 2)) - 1;
+            }
+            return std::max(minNs, std::min(bound, maxNs));
+        }
+
+        return maxNs;
+    }
+
+    DBQueryStats::DBQueryStats(sqlite3* handle)
+        : m_handle(handle)
+        , m_mutex()
+        , m_entries()
+        , m_byNormalized()
+        , m_byText()
+        , m_running()
+        , m_paused(false)
+    {
+        sqlite3_trace_v2(m_handle, SQLITE_TRACE_STMT | SQLITE_TRACE_ROW | SQLITE_TRACE_PROFILE,
+                         &DBQueryStats::trace, this);
+    }
+
+    DBQueryStats::~DBQueryStats()
+    {
+        sqlite3_trace_v2(m_handle, 0, NULL, NULL);
+    }
+
+    std::vector<DBStatementStats> DBQueryStats::snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return collect(false);
+    }
+
+    std::vector<DBStatementStats> DBQueryStats::interval()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::vector<DBStatementStats> result = collect(true);
+        for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+            it->current = Totals();
+        }
+
+        return result;
+    }
+
+    void DBQueryStats::reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // running statements keep their entry pointers, so only counters go.
+        for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+            it->total = Totals();
+            it->current = Totals();
+        }
+    }
+
+    void DBQueryStats::pause(bool paused)
+    {
+        m_paused = paused;
+    }
+
+    std::string DBQueryStats::normalize(const char* sql)
+    {
+        std::string result;
+        if (NULL == sql) {
+            return result;
+        }
+
+        const char* p = sql;
+        bool space = false;
+        while (*p) {
+            char c = *p;
+            bool word = !result.empty()
+                        && (isalnum((unsigned char)result[result.size() - 1]) || '_' == result[result.size() - 1]);
+
+            if (isspace((unsigned char)c)) {
+                space = true;
+                p++;
+                continue;
+            }
+            if (space && !result.empty()) {
+                result += ' ';
+                word = false;
+            }
+            space = false;
+
+            if ('\'' == c || (('x' == c || 'X' == c) && '\'' == p[1] && !word)) {
+                // string and blob literals, '' is an escaped quote.
+                p += ('\'' == c) ? 1 : 2;
+                while (*p) {
+                    if ('\'' == *p) {
+                        if ('\'' != p[1]) {
+                            p++;
+                            break;
+                        }
+                        p++;
+                    }
+                    p++;
+                }
+                result += '?';
+            }
+            else if (isdigit((unsigned char)c) && !word
+                     && (result.empty() || '?' != result[result.size() - 1])) {
+                while (isalnum((unsigned char)*p) || '.' == *p) {
+                    p++;
+                }
+                result += '?';
+            }
+            else if ('"' == c || '`' == c || '[' == c) {
+                // quoted identifiers are kept as they are.
+                char close = ('[' == c) ? ']' : c;
+                result += *p++;
+                while (*p && close != *p) {
+                    result += *p++;
+                }
+                if (*p) {
+                    result += *p++;
+                }
+            }
+            else {
+                result += c;
+                p++;
+            }
+        }
+
+        return result;
+    }
+
+    int DBQueryStats::trace(unsigned type, void* context, void* p, void* x)
+    {
+        DBQueryStats* self = static_cast<DBQueryStats*>(context);
+        sqlite3_stmt* stmt = static_cast<sqlite3_stmt*>(p);
+        if (self->m_paused) {
+            return 0;
+        }
+
+        switch (type) {
+        case SQLITE_TRACE_STMT:
+            self->onStart(stmt);
+            break;
+        case SQLITE_TRACE_ROW:
+            self->onRow(stmt);
+            break;
+        case SQLITE_TRACE_PROFILE:
+            self->onEnd(stmt);
+            break;
+        default:
+            break;
+        }
+
+        return 0;
+    }
+
+    void DBQueryStats::onStart(sqlite3_stmt* stmt)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // trigger programs report again on the same statement.
+        if (m_running.find(stmt) != m_running.end()) {
+            return;
+        }
+
+        const char* text = sqlite3_sql(stmt);
+        std::string raw(text ? text : "");
+
+        Entry* entry = NULL;
+        std::unordered_map<std::string, Entry*>::iterator it = m_byText.find(raw);
+        if (it != m_byText.end()) {
+            entry = it->second;
+        }
+        else {
+            std::string normalized = normalize(raw.c_str());
+            std::unordered_map<std::string, Entry*>::iterator found = m_byNormalized.find(normalized);
+            if (found != m_byNormalized.end()) {
+                entry = found->second;
+            }
+            else {
+                m_entries.push_back(Entry());
+                entry = &m_entries.back();
+                entry->sql = normalized;
+                m_byNormalized[normalized] = entry;
+            }
+            if (m_byText.size() >= MaxTextCache) {
+                // texts with inlined values never repeat, keep the cache bounded.
+                m_byText.clear();
+            }
+            m_byText[raw] = entry;
+        }
+
+        Running& running = m_running[stmt];
+        running.entry = entry;
+        running.rows = 0;
+        running.changes = sqlite3_total_changes(m_handle);
+        running.start = Clock::now();
+    }
+
+    // once per row of every query, the counts are folded into the entry under the lock at the end.
+    void DBQueryStats::onRow(sqlite3_stmt* stmt)
+    {
+        std::unordered_map<sqlite3_stmt*, Running>::iterator it = m_running.find(stmt);
+        if (it != m_running.end()) {
+            it->second.rows++;
+        }
+    }
+
+    void DBQueryStats::onEnd(sqlite3_stmt* stmt)
+    {
+        Clock::time_point end = Clock::now();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::unordered_map<sqlite3_stmt*, Running>::iterator it = m_running.find(stmt);
+        if (it == m_running.end()) {
+            return;
+        }
+
+        const Running& running = it->second;
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - running.start).count();
+        int changes = sqlite3_total_changes(m_handle) - running.changes;
+        if (changes < 0) {
+            changes = 0;
+        }
+
+        running.entry->total.add(ns, running.rows, changes);
+        running.entry->current.add(ns, running.rows, changes);
+
+        m_running.erase(it);
+    }
+
+    void DBQueryStats::fill(const Entry& entry, const Totals& totals, DBStatementStats& stats)
+    {
+        stats.sql = entry.sql;
+        stats.count = totals.count;
+        stats.totalNs = totals.totalNs;
+        stats.minNs = totals.minNs;
+        stats.maxNs = totals.maxNs;
+        stats.p50Ns = totals.percentile(0.50);
+        stats.p99Ns = totals.percentile(0.99);
+        stats.rowsReturned = totals.rowsReturned;
+        stats.rowsChanged = totals.rowsChanged;
+    }
+
+    static bool byTotalTime(const DBStatementStats& a, const DBStatementStats& b)
+    {
+        return a.totalNs > b.totalNs;
+    }
+
+    std::vector<DBStatementStats> DBQueryStats::collect(bool current) const
+    {
+        std::vector<DBStatementStats> result;
+        for (std::list<Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+            const Totals& totals = current ? it->current : it->total;
+            if (0 == totals.count) {
+                continue;
+            }
+
+            DBStatementStats stats;
+            fill(*it, totals, stats);
+            result.push_back(stats);
+        }
+
+        std::sort(result.begin(), result.end(), byTotalTime);
+
+        return result;
+    }
+
+} /* namespace sql */
+/* EOF */
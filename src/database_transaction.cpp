@@ -0,0 +1,114 @@
+#include <sstream>
+
+#include "database.h"
+#include "sqlite3.h"
+
+namespace sql
+{
+    Transaction::Transaction(database& db, DBTransactionMode mode)
+        : m_db(db)
+        , m_savepoint()
+        , m_active(false)
+    {
+        if (NULL == m_db.m_dbHandle) {
+            return;
+        }
+
+        int err = SQLITE_OK;
+        if (0 == m_db.m_transactionDepth && sqlite3_get_autocommit(m_db.m_dbHandle)) {
+            switch (mode) {
+            case DBTransaction_Immediate:
+                err = m_db.exec("BEGIN IMMEDIATE");
+                break;
+            case DBTransaction_Exclusive:
+                err = m_db.exec("BEGIN EXCLUSIVE");
+                break;
+            case DBTransaction_Deferred:
+            default:
+                err = m_db.exec("BEGIN DEFERRED");
+                break;
+            }
+        }
+        else {
+            // nested scope, or a transaction opened through exec().
+            std::ostringstream name;
+            name << "sql_savepoint_" << m_db.m_transactionDepth;
+            m_savepoint = name.str();
+
+            err = m_db.exec("SAVEPOINT " + m_savepoint);
+        }
+
+        if (err == SQLITE_OK) {
+            m_active = true;
+            m_db.m_transactionDepth++;
+        }
+    }
+
+    Transaction::~Transaction()
+    {
+        if (m_active) {
+            rollback();
+        }
+    }
+
+    int Transaction::commit()
+    {
+        if (!m_active) {
+            return DB_ERROR;
+        }
+
+        int err = SQLITE_OK;
+        if (m_savepoint.empty()) {
+            err = m_db.exec("COMMIT");
+        }
+        else {
+            err = m_db.exec("RELEASE " + m_savepoint);
+        }
+
+        // a failed COMMIT leaves the transaction open for rollback.
+        if (err == SQLITE_OK) {
+            m_active = false;
+            m_db.m_transactionDepth--;
+        }
+
+        return err;
+    }
+
+    int Transaction::rollback()
+    {
+        if (!m_active) {
+            return DB_ERROR;
+        }
+
+        int err = SQLITE_OK;
+        if (m_savepoint.empty()) {
+            // sqlite may already have rolled back on its own after an error.
+            if (!sqlite3_get_autocommit(m_db.m_dbHandle)) {
+                err = m_db.exec("ROLLBACK");
+            }
+        }
+        else {
+            err = m_db.exec("ROLLBACK TO " + m_savepoint);
+            if (err == SQLITE_OK) {
+                err = m_db.exec("RELEASE " + m_savepoint);
+            }
+        }
+
+        m_active = false;
+        m_db.m_transactionDepth--;
+
+        return err;
+    }
+
+    bool Transaction::isActive() const
+    {
+        return m_active;
+    }
+
+    bool Transaction::isNested() const
+    {
+        return !m_savepoint.empty();
+    }
+
+} /* namespace sql */
+/* EOF */
@@ -0,0 +1,176 @@
+#include <cstring>
+#include <exception>
+
+#include "database_writer.h"
+
+namespace sql
+{
+    WriteQueue::WriteQueue(database& db, int maxBatchSize, int maxLatencyMs)
+        : m_db(db)
+        , m_maxBatchSize(maxBatchSize > 0 ? maxBatchSize : 1)
+        , m_maxLatencyMs(maxLatencyMs > 0 ? maxLatencyMs : 0)
+        , m_mutex()
+        , m_pending()
+        , m_queue()
+        , m_stopping(false)
+        , m_writer()
+    {
+        memset(&m_stats, 0, sizeof(m_stats));
+
+        m_writer = std::thread(&WriteQueue::run, this);
+    }
+
+    WriteQueue::~WriteQueue()
+    {
+        stop();
+    }
+
+    std::future<int64_t> WriteQueue::enqueue(const Operation& op)
+    {
+        Request request;
+        request.op = op;
+        request.queued = std::chrono::steady_clock::now();
+
+        std::future<int64_t> future = request.result.get_future();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            request.result.set_value(-1);
+            return future;
+        }
+
+        m_queue.push_back(std::move(request));
+        if (m_queue.size() == 1 || (int)m_queue.size() >= m_maxBatchSize) {
+            m_pending.notify_one();
+        }
+
+        return future;
+    }
+
+    std::future<int64_t> WriteQueue::insert(const std::string& table, const DBDataRow& values)
+    {
+        return enqueue([table, values](database& db) {
+            return db.insert(table, values);
+        });
+    }
+
+    std::future<int64_t> WriteQueue::update(const std::string& table, const DBDataRow& values,
+                                            const std::string& where, const std::vector<std::string>& whereArgs)
+    {
+        return enqueue([table, values, where, whereArgs](database& db) {
+            return db.update(table, values, where, whereArgs);
+        });
+    }
+
+    std::future<int64_t> WriteQueue::remove(const std::string& table, const std::string& where,
+                                            const std::vector<std::string>& whereArgs)
+    {
+        return enqueue([table, where, whereArgs](database& db) {
+            return db.remove(table, where, whereArgs);
+        });
+    }
+
+    void WriteQueue::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_pending.notify_one();
+        }
+
+        if (m_writer.joinable()) {
+            m_writer.join();
+        }
+    }
+
+    DBWriteQueueStats WriteQueue::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void WriteQueue::run()
+    {
+        std::vector<Request> batch;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            while (m_queue.empty() && !m_stopping) {
+                m_pending.wait(lock);
+            }
+
+            if (m_queue.empty()) {
+                break;
+            }
+
+            // give other producers until the oldest request is due to join the flush.
+            std::chrono::steady_clock::time_point due =
+                    m_queue.front().queued + std::chrono::milliseconds(m_maxLatencyMs);
+            while (!m_stopping && (int)m_queue.size() < m_maxBatchSize) {
+                if (m_pending.wait_until(lock, due) == std::cv_status::timeout) {
+                    break;
+                }
+            }
+
+            while (!m_queue.empty() && (int)batch.size() < m_maxBatchSize) {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+
+            lock.unlock();
+            flush(batch);
+            batch.clear();
+            lock.lock();
+        }
+    }
+
+    void WriteQueue::flush(std::vector<Request>& batch)
+    {
+        std::vector<int64_t> results(batch.size(), -1);
+        std::vector<std::exception_ptr> errors(batch.size());
+
+        Transaction transaction(m_db, DBTransaction_Immediate);
+        bool committed = false;
+
+        if (transaction.isActive()) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                Transaction savepoint(m_db);
+                // a throwing operation is rolled back like a failing one, the producer gets the exception.
+                try {
+                    results[i] = batch[i].op(m_db);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+                if (!errors[i] && results[i] >= 0) {
+                    savepoint.commit();
+                }
+            }
+
+            committed = (transaction.commit() == DB_OK);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.operations += batch.size();
+            m_stats.flushes++;
+            if (!committed) {
+                m_stats.failedCommits++;
+            }
+            if (batch.size() > m_stats.maxBatch) {
+                m_stats.maxBatch = batch.size();
+            }
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (errors[i]) {
+                batch[i].result.set_exception(errors[i]);
+            }
+            else {
+                batch[i].result.set_value(committed ? results[i] : -1);
+            }
+        }
+    }
+
+} /* namespace sql */
+/* EOF */
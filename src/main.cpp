@@ -20,7 +20,7 @@ void printResult(DBDataTable *t)
             switch (type) {
             case DBDataType_Integer:
             {
-                int value = t->getLong(j, i);
+                int64_t value = t->getLong(j, i);
                 std::cout << "column " << i << " value is " << value << "\n";
                 break;
             }
@@ -72,7 +72,7 @@ int main()
     row.putLong(2, 30, "AGE");
     row.putString(3, "Huaihai RD.", 12, "ADDRESS");
     row.putDouble(4, 3000.00, "SALARY");
-    int result = db.insert("TEST", row);
+    int64_t result = db.insert("TEST", row);
     std::cout << "insert return value is " << result << "\n";
 
     DBDataRow row1(5);
@@ -86,13 +86,8 @@ int main()
 
 
     std::vector<std::string> v;
-    DBDataTable *t = db.rawQuery("select * from TEST", v);
-    printResult(t);
-
-    // TODO: change to smart pointer.
-    if (t) {
-        delete t;
-    }
+    std::unique_ptr<DBDataTable> t = db.rawQuery("select * from TEST", v);
+    printResult(t.get());
 
     DBDataRow row2(1);
     row2.putString(0, "Joy2", 5, "NAME");
@@ -111,23 +106,13 @@ int main()
     args.push_back("Huaihai RD.");
     t = db.query("TEST", columns, "ADDRESS=?", args, "NAME");
     //t = db.rawQuery("SELECT ID, NAME, AGE  FROM TEST WHERE ADDRESS=? ORDER BY AGE", args);
-    printResult(t);
-
-    // TODO: change to smart pointer.
-    if (t) {
-        delete t;
-    }
+    printResult(t.get());
 
     result = db.remove("TEST", "ADDRESS=?", args);
     std::cout << "remove return value is " << result << "\n";
 
     t = db.rawQuery("select * from TEST", v);
-    printResult(t);
-
-    // TODO: change to smart pointer.
-    if (t) {
-        delete t;
-    }
+    printResult(t.get());
 
     err = db.exec("DROP TABLE TEST;");
     if (err != DB_OK) {
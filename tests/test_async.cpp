@@ -0,0 +1,99 @@
+#include <stdexcept>
+
+#include "test_util.h"
+#include "database_async.h"
+
+using namespace sql;
+
+static int throwingOperation(database&)
+{
+    throw std::runtime_error("operation failed");
+}
+
+/*takes the result or the exception of the operation*/
+struct Outcome
+{
+    std::promise<int>* result;
+
+    void operator()(int value) const
+    {
+        result->set_value(value);
+    }
+
+    void operator()(std::exception_ptr error) const
+    {
+        result->set_exception(error);
+    }
+};
+
+static int futureRethrows()
+{
+    database db(testPath("async_future"));
+    AsyncDatabase async(db);
+
+    std::future<int> result = async.submit(throwingOperation);
+    CHECK(result.valid());
+
+    bool thrown = false;
+    try {
+        result.get();
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    return 0;
+}
+
+static int callbackTakesException()
+{
+    database db(testPath("async_callback_error"));
+    AsyncDatabase async(db);
+
+    std::promise<int> promise;
+    Outcome outcome;
+    outcome.result = &promise;
+    CHECK(async.submit(throwingOperation, outcome) == DB_OK);
+
+    bool thrown = false;
+    try {
+        promise.get_future().get();
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    return 0;
+}
+
+static int plainCallbackIsDropped()
+{
+    database db(testPath("async_callback_plain"));
+    AsyncDatabase async(db);
+
+    bool called = false;
+    CHECK(async.submit(throwingOperation, [&called](int) { called = true; }) == DB_OK);
+
+    // the worker survives and runs the next operation.
+    std::future<int> next = async.submit([](database&) { return 7; });
+    CHECK(next.get() == 7);
+
+    async.stop();
+    CHECK(!called);
+    CHECK(async.getStats().dropped == 1);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(futureRethrows);
+    RUN(callbackTakesException);
+    RUN(plainCallbackIsDropped);
+
+    return failures ? 1 : 0;
+}
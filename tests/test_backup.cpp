@@ -0,0 +1,120 @@
+#include <chrono>
+#include <thread>
+
+#include "test_util.h"
+#include "database_backup.h"
+
+using namespace sql;
+
+static int openSource(database& db, int rows)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY, DATA BLOB)") == DB_OK);
+    CHECK(db.exec("BEGIN") == DB_OK);
+    for (int i = 0; i < rows; i++) {
+        CHECK(db.exec("INSERT INTO T(DATA) VALUES (zeroblob(1000))") == DB_OK);
+    }
+    CHECK(db.exec("COMMIT") == DB_OK);
+
+    return 0;
+}
+
+static int copiesEveryPage()
+{
+    database db(testPath("backup_source"));
+    CHECK(openSource(db, 100) == 0);
+
+    std::string path = testPath("backup_copy");
+    uint64_t calls = 0;
+    std::unique_ptr<DBBackup> backup = db.backupTo(path, 8, 0, NULL, 0,
+                                                   [&calls](const DBBackupProgress&) { calls++; });
+    CHECK(backup);
+    CHECK(backup->wait() == DB_OK);
+    CHECK(backup->isDone());
+
+    DBBackupProgress progress = backup->getProgress();
+    CHECK(progress.remaining == 0);
+    CHECK(progress.pageCount > 8);
+    CHECK(progress.steps > 1 && progress.steps == calls);
+
+    database copy(path);
+    CHECK(queryLong(copy, "SELECT COUNT(*) FROM T") == 100);
+
+    return 0;
+}
+
+static int snapshotsIntoMemory()
+{
+    database db(testPath("backup_snapshot"));
+    CHECK(openSource(db, 10) == 0);
+
+    database snapshot(":memory:");
+    std::unique_ptr<DBBackup> backup = db.backupTo(snapshot);
+    CHECK(backup);
+    CHECK(backup->wait() == DB_OK);
+    backup.reset();
+
+    CHECK(db.exec("DELETE FROM T") == DB_OK);
+    CHECK(queryLong(snapshot, "SELECT COUNT(*) FROM T") == 10);
+
+    return 0;
+}
+
+static int backsOffWhileLocked()
+{
+    std::string path = testPath("backup_locked");
+    database db(path);
+    CHECK(openSource(db, 10) == 0);
+    db.setBusyTimeout(0);
+
+    // no reader gets past an exclusive lock in the rollback journal.
+    database locker(path);
+    CHECK(locker.exec("BEGIN EXCLUSIVE") == DB_OK);
+
+    std::string copyPath = testPath("backup_locked_copy");
+    std::unique_ptr<DBBackup> backup = db.backupTo(copyPath, 8, 0);
+    CHECK(backup);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    backup->cancel();
+    CHECK(backup->wait() == DB_CANCELLED);
+
+    // sleepMs is 0, still every locked step waited before the next one.
+    DBBackupProgress progress = backup->getProgress();
+    CHECK(progress.busy >= 1);
+    CHECK(progress.busy <= 50 / 5 + 2);
+    CHECK(progress.remaining != 0 || progress.pageCount == 0);
+
+    CHECK(locker.exec("COMMIT") == DB_OK);
+
+    return 0;
+}
+
+static int cancelLeavesDestination()
+{
+    database db(testPath("backup_cancel"));
+    CHECK(openSource(db, 100) == 0);
+
+    std::string path = testPath("backup_cancel_copy");
+    std::unique_ptr<DBBackup> backup = db.backupTo(path, 1, 1000);
+    CHECK(backup);
+    backup->cancel();
+    CHECK(backup->wait() == DB_CANCELLED);
+
+    // an unfinished backup is rolled back.
+    database copy(path);
+    CHECK(queryLong(copy, "SELECT COUNT(*) FROM sqlite_master") == 0);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(copiesEveryPage);
+    RUN(snapshotsIntoMemory);
+    RUN(backsOffWhileLocked);
+    RUN(cancelLeavesDestination);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+#include "test_util.h"
+#include "database_change.h"
+#include "database_cursor.h"
+
+using namespace sql;
+
+static int openTable(database& db)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE U(N INTEGER CHECK (N < 3))") == DB_OK);
+
+    return 0;
+}
+
+static std::vector<DBChange> pollAll(DBChangeFeed& feed)
+{
+    std::vector<DBChange> changes;
+    DBChange change;
+    while (feed.poll(change)) {
+        changes.push_back(change);
+    }
+
+    return changes;
+}
+
+static int publishesOnCommit()
+{
+    database db(testPath("change_commit"));
+    CHECK(openTable(db) == 0);
+    std::shared_ptr<DBChangeFeed> feed = db.subscribeChanges();
+    CHECK(feed);
+
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (1)") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (2)") == DB_OK);
+    CHECK(pollAll(*feed).empty());
+    CHECK(db.exec("COMMIT") == DB_OK);
+
+    std::vector<DBChange> changes = pollAll(*feed);
+    CHECK(changes.size() == 2);
+    CHECK(changes[0].op == DBChange_Insert && changes[0].rowid == 1);
+    CHECK(changes[1].rowid == 2);
+    CHECK(changes[0].table == "U" && changes[0].sequence == changes[1].sequence);
+
+    // an autocommit statement is a transaction of its own.
+    CHECK(db.exec("DELETE FROM U WHERE N = 1") == DB_OK);
+    changes = pollAll(*feed);
+    CHECK(changes.size() == 1);
+    CHECK(changes[0].op == DBChange_Delete && changes[0].rowid == 1);
+
+    return 0;
+}
+
+static int dropsFailedExecStatement()
+{
+    database db(testPath("change_exec"));
+    CHECK(openTable(db) == 0);
+    std::shared_ptr<DBChangeFeed> feed = db.subscribeChanges();
+
+    // the third row fails the CHECK, the statement takes back the first two.
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (1), (2), (3)") != DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (0)") == DB_OK);
+    CHECK(db.exec("COMMIT") == DB_OK);
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM U") == 1);
+
+    std::vector<DBChange> changes = pollAll(*feed);
+    CHECK(changes.size() == 1);
+    CHECK(changes[0].rowid == 1);
+
+    // same for a statement in the middle of one exec() call.
+    CHECK(db.exec("BEGIN; INSERT INTO U(N) VALUES (1); INSERT INTO U(N) VALUES (2), (5)") != DB_OK);
+    CHECK(db.exec("COMMIT") == DB_OK);
+    changes = pollAll(*feed);
+    CHECK(changes.size() == 1);
+    CHECK(changes[0].rowid == 2);
+
+    return 0;
+}
+
+static int dropsFailedQueryWrite()
+{
+    database db(testPath("change_query"));
+    CHECK(openTable(db) == 0);
+    std::shared_ptr<DBChangeFeed> feed = db.subscribeChanges();
+
+    // a write through rawQuery fails on its third row.
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.rawQuery("INSERT INTO U(N) SELECT column1 FROM (VALUES (1), (2), (3))",
+                      std::vector<std::string>()) == NULL);
+    CHECK(db.lastError() != DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (0)") == DB_OK);
+    CHECK(db.exec("COMMIT") == DB_OK);
+
+    std::vector<DBChange> changes = pollAll(*feed);
+    CHECK(changes.size() == 1);
+    CHECK(changes[0].rowid == 1);
+
+    // the autocommit write of a cursor is published once it finished.
+    std::unique_ptr<Cursor> cursor = db.rawQueryCursor("INSERT INTO U(N) VALUES (1), (2) RETURNING N",
+                                                       std::vector<std::string>());
+    CHECK(cursor);
+    CHECK(cursor->next());
+    CHECK(pollAll(*feed).empty());
+    CHECK(cursor->next());
+    CHECK(!cursor->next() && cursor->isDone());
+    changes = pollAll(*feed);
+    CHECK(changes.size() == 2);
+
+    cursor = db.rawQueryCursor("INSERT INTO U(N) VALUES (1), (5) RETURNING N", std::vector<std::string>());
+    CHECK(cursor);
+    CHECK(!cursor->next() && !cursor->isDone());
+    cursor.reset();
+    CHECK(db.exec("INSERT INTO U(N) VALUES (2)") == DB_OK);
+    changes = pollAll(*feed);
+    CHECK(changes.size() == 1);
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM U") == 4);
+
+    return 0;
+}
+
+static int dropsRolledBackChanges()
+{
+    database db(testPath("change_rollback"));
+    CHECK(openTable(db) == 0);
+    std::shared_ptr<DBChangeFeed> feed = db.subscribeChanges();
+
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (1)") == DB_OK);
+    CHECK(db.exec("ROLLBACK") == DB_OK);
+    CHECK(pollAll(*feed).empty());
+
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (1)") == DB_OK);
+    CHECK(db.exec("SAVEPOINT sp") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (2)") == DB_OK);
+    CHECK(db.exec("ROLLBACK TO sp") == DB_OK);
+    CHECK(db.exec("RELEASE sp") == DB_OK);
+    CHECK(db.exec("COMMIT") == DB_OK);
+
+    std::vector<DBChange> changes = pollAll(*feed);
+    CHECK(changes.size() == 1);
+    CHECK(changes[0].rowid == 1);
+
+    return 0;
+}
+
+static int keepsChangesWhileCommitIsBusy()
+{
+    std::string path = testPath("change_busy");
+    database db(path);
+    CHECK(openTable(db) == 0);
+    db.setBusyTimeout(0);
+    std::shared_ptr<DBChangeFeed> feed = db.subscribeChanges();
+
+    database reader(path);
+    CHECK(reader.isOpen());
+    reader.setBusyTimeout(0);
+
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (1)") == DB_OK);
+
+    // a reader in the rollback journal keeps the writer from committing.
+    CHECK(reader.exec("BEGIN") == DB_OK);
+    CHECK(queryLong(reader, "SELECT COUNT(*) FROM U") == 0);
+    CHECK(db.exec("COMMIT") == DB_BUSY);
+    CHECK(pollAll(*feed).empty());
+
+    CHECK(reader.exec("COMMIT") == DB_OK);
+    CHECK(db.exec("COMMIT") == DB_OK);
+    std::vector<DBChange> changes = pollAll(*feed);
+    CHECK(changes.size() == 1);
+    CHECK(changes[0].rowid == 1);
+
+    // given up after the busy commit, nothing is published.
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("INSERT INTO U(N) VALUES (2)") == DB_OK);
+    CHECK(reader.exec("BEGIN") == DB_OK);
+    CHECK(queryLong(reader, "SELECT COUNT(*) FROM U") == 1);
+    CHECK(db.exec("COMMIT") == DB_BUSY);
+    CHECK(db.exec("ROLLBACK") == DB_OK);
+    CHECK(reader.exec("COMMIT") == DB_OK);
+    CHECK(pollAll(*feed).empty());
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM U") == 1);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(publishesOnCommit);
+    RUN(dropsFailedExecStatement);
+    RUN(dropsFailedQueryWrite);
+    RUN(dropsRolledBackChanges);
+    RUN(keepsChangesWhileCommitIsBusy);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+#include "test_util.h"
+#include "database_cursor.h"
+#include "sqlite3.h"
+
+using namespace sql;
+
+static const std::vector<std::string> NO_ARGS;
+
+static int openTable(database& db)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY, NAME TEXT)") == DB_OK);
+    CHECK(db.exec("INSERT INTO T VALUES (1, 'a'), (2, 'b'), (3, 'c')") == DB_OK);
+
+    return 0;
+}
+
+static int readsEveryRowOnce()
+{
+    database db(testPath("cursor_rows"));
+    CHECK(openTable(db) == 0);
+
+    std::unique_ptr<Cursor> cursor = db.rawQueryCursor("SELECT ID, NAME FROM T ORDER BY ID", NO_ARGS);
+    CHECK(cursor);
+    CHECK(cursor->getColumnCount() == 2);
+    CHECK(cursor->getColumnIndex("NAME") == 1);
+
+    int64_t expected = 1;
+    while (cursor->next()) {
+        CHECK(cursor->getLong(0) == expected);
+        size_t length = 0;
+        const char* name = cursor->getString(1, length);
+        CHECK(name && length == 1 && name[0] == 'a' + expected - 1);
+        expected++;
+    }
+    CHECK(expected == 4);
+    CHECK(cursor->isDone());
+
+    // a loop entered again does not start over.
+    CHECK(!cursor->next());
+    CHECK(cursor->isDone());
+
+    return 0;
+}
+
+static int runsWriteOnce()
+{
+    database db(testPath("cursor_write"));
+    CHECK(openTable(db) == 0);
+
+    std::unique_ptr<Cursor> cursor = db.rawQueryCursor("INSERT INTO T(NAME) VALUES ('d')", NO_ARGS);
+    CHECK(cursor);
+    CHECK(!cursor->next());
+    CHECK(!cursor->next());
+    cursor.reset();
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM T") == 4);
+
+    return 0;
+}
+
+static int stopsAtError()
+{
+    database db(testPath("cursor_error"));
+    CHECK(openTable(db) == 0);
+
+    // abs() of the smallest integer overflows on the second row.
+    std::unique_ptr<Cursor> cursor = db.rawQueryCursor(
+            "SELECT CASE WHEN ID = 2 THEN abs(-9223372036854775807 - 1) ELSE ID END FROM T ORDER BY ID", NO_ARGS);
+    CHECK(cursor);
+    CHECK(cursor->next());
+    CHECK(cursor->getLong(0) == 1);
+    CHECK(!cursor->next());
+    int error = cursor->getError();
+    CHECK(error != SQLITE_OK && error != SQLITE_DONE);
+
+    // no retry from the first row.
+    CHECK(!cursor->next());
+    CHECK(cursor->getError() == error);
+    CHECK(!cursor->isDone());
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(readsEveryRowOnce);
+    RUN(runsWriteOnce);
+    RUN(stopsAtError);
+
+    return failures ? 1 : 0;
+}
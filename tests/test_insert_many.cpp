@@ -0,0 +1,85 @@
+#include "test_util.h"
+
+using namespace sql;
+
+static DBDataTable makeRows(const std::vector<int64_t>& parents)
+{
+    DBDataTable table(2);
+    table.setColumnName(0, "ID");
+    table.setColumnName(1, "PARENT");
+    for (size_t i = 0; i < parents.size(); i++) {
+        table.addRow();
+        table.putLong(i, 0, i + 1);
+        table.putLong(i, 1, parents[i]);
+    }
+
+    return table;
+}
+
+static int openChild(database& db)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("PRAGMA foreign_keys=ON") == DB_OK);
+    CHECK(db.exec("CREATE TABLE PARENT(ID INTEGER PRIMARY KEY)") == DB_OK);
+    CHECK(db.exec("INSERT INTO PARENT VALUES (1)") == DB_OK);
+    // checked at COMMIT, so a bad row makes the batch commit fail.
+    CHECK(db.exec("CREATE TABLE CHILD(ID INTEGER PRIMARY KEY, PARENT INTEGER"
+                  " REFERENCES PARENT(ID) DEFERRABLE INITIALLY DEFERRED)") == DB_OK);
+
+    return 0;
+}
+
+static int insertsInBatches()
+{
+    database db(testPath("insert_many_batches"));
+    CHECK(openChild(db) == 0);
+    db.setBatchSize(2);
+
+    std::vector<int64_t> parents(5, 1);
+    CHECK(db.insertMany("CHILD", makeRows(parents)) == 5);
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM CHILD") == 5);
+
+    return 0;
+}
+
+static int stopsWhenBatchCommitFails()
+{
+    database db(testPath("insert_many_commit"));
+    CHECK(openChild(db) == 0);
+    db.setBatchSize(2);
+
+    // the second batch (rows 3 and 4) cannot commit.
+    std::vector<int64_t> parents;
+    parents.push_back(1);
+    parents.push_back(1);
+    parents.push_back(1);
+    parents.push_back(2);
+    parents.push_back(1);
+    parents.push_back(1);
+
+    DBDataTable rows = makeRows(parents);
+    // row 5 would fail as a duplicate if it was still tried.
+    rows.putLong(4, 0, 1);
+
+    std::vector<int> failedRows;
+    CHECK(db.insertMany("CHILD", rows, &failedRows) == -1);
+    CHECK(db.lastError() == DB_ERROR);
+    CHECK(failedRows.empty());
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM CHILD") == 2);
+
+    // no transaction is left open behind the failed batch.
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("COMMIT") == DB_OK);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(insertsInBatches);
+    RUN(stopsWhenBatchCommitFails);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+#include "test_util.h"
+#include "database_pool.h"
+
+using namespace sql;
+
+static int leasesReadersAndWriter()
+{
+    std::string path = testPath("pool_leases");
+    DatabasePool pool(path, 2);
+    CHECK(pool.isOpen());
+    CHECK(pool.getReaderCount() == 2);
+
+    DatabasePool::Lease writer = pool.acquireWriter();
+    CHECK(writer.isValid());
+    CHECK(writer->exec("CREATE TABLE T(ID INTEGER PRIMARY KEY)") == DB_OK);
+    CHECK(writer->exec("INSERT INTO T VALUES (1)") == DB_OK);
+
+    // readers see the committed rows while the writer is still leased.
+    DatabasePool::Lease first = pool.acquireReader(0);
+    DatabasePool::Lease second = pool.acquireReader(0);
+    CHECK(first.isValid() && second.isValid());
+    CHECK(first.get() != second.get());
+    CHECK(queryLong(*first, "SELECT COUNT(*) FROM T") == 1);
+
+    // every connection is leased, so both wait and time out.
+    CHECK(!pool.acquireReader(10).isValid());
+    CHECK(!pool.acquireWriter(10).isValid());
+
+    first.release();
+    CHECK(pool.acquireReader(0).isValid());
+    writer.release();
+    CHECK(pool.acquireWriter(0).isValid());
+
+    DBPoolStats stats = pool.getStats();
+    CHECK(stats.reader.leases == 3 && stats.reader.timeouts == 1);
+    CHECK(stats.writer.leases == 2 && stats.writer.timeouts == 1);
+
+    return 0;
+}
+
+static int refusesDatabaseWithoutWal()
+{
+    // journal_mode=WAL answers "memory" here without failing.
+    DatabasePool pool(":memory:", 2);
+    CHECK(!pool.isOpen());
+    CHECK(pool.getReaderCount() == 0);
+    CHECK(!pool.acquireWriter(0).isValid());
+    // would wait forever for the writer if the pool counted as open.
+    CHECK(!pool.acquireReader().isValid());
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(leasesReadersAndWriter);
+    RUN(refusesDatabaseWithoutWal);
+
+    return failures ? 1 : 0;
+}
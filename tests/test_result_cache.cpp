@@ -0,0 +1,130 @@
+#include "test_util.h"
+#include "database_cursor.h"
+
+using namespace sql;
+
+static const std::vector<std::string> NO_ARGS;
+
+static int openTable(database& db)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY, NAME TEXT)") == DB_OK);
+    CHECK(db.exec("INSERT INTO T VALUES (1, 'a'), (2, 'b')") == DB_OK);
+    db.setResultCacheSize(1 << 20, false);
+
+    return 0;
+}
+
+static int64_t cachedCount(database& db)
+{
+    std::shared_ptr<const DBDataTable> table = db.rawQueryCached("SELECT COUNT(*) FROM T", NO_ARGS);
+
+    return table ? table->getLong(0, 0) : -1;
+}
+
+static int hitsUntilTableChanges()
+{
+    database db(testPath("result_cache_hits"));
+    CHECK(openTable(db) == 0);
+
+    std::shared_ptr<const DBDataTable> first = db.rawQueryCached("SELECT NAME FROM T WHERE ID = ?",
+                                                                 std::vector<std::string>(1, "1"));
+    std::shared_ptr<const DBDataTable> second = db.rawQueryCached("SELECT NAME FROM T WHERE ID = ?",
+                                                                  std::vector<std::string>(1, "1"));
+    CHECK(first && first == second);
+    // other arguments are another entry.
+    CHECK(db.rawQueryCached("SELECT NAME FROM T WHERE ID = ?", std::vector<std::string>(1, "2")) != first);
+
+    DBResultCacheStats stats = db.getResultCacheStats();
+    CHECK(stats.hits == 1 && stats.misses == 2 && stats.entries == 2);
+
+    CHECK(cachedCount(db) == 2);
+    DBDataRow row(1);
+    row.putString(0, "c", 2, "NAME");
+    CHECK(db.insert("T", row) == 3);
+    CHECK(cachedCount(db) == 3);
+    CHECK(db.getResultCacheStats().invalidations >= 1);
+
+    return 0;
+}
+
+static int clearsOnQueryWrites()
+{
+    database db(testPath("result_cache_writes"));
+    CHECK(openTable(db) == 0);
+    CHECK(cachedCount(db) == 2);
+
+    // truncating, the update hook sees no rows.
+    CHECK(db.rawQuery("DELETE FROM T", NO_ARGS) == NULL);
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM T") == 0);
+    CHECK(cachedCount(db) == 0);
+
+    CHECK(db.exec("INSERT INTO T VALUES (1, 'a')") == DB_OK);
+    CHECK(cachedCount(db) == 1);
+    std::unique_ptr<Cursor> cursor = db.rawQueryCursor("DELETE FROM T", NO_ARGS);
+    CHECK(cursor);
+    CHECK(!cursor->next() && cursor->isDone());
+    cursor.reset();
+    CHECK(cachedCount(db) == 0);
+
+    // a write through the cached path runs every time.
+    CHECK(db.rawQueryCached("INSERT INTO T(NAME) VALUES ('x')", NO_ARGS) == NULL);
+    CHECK(db.rawQueryCached("INSERT INTO T(NAME) VALUES ('x')", NO_ARGS) == NULL);
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM T") == 2);
+
+    return 0;
+}
+
+static int dropsRolledBackResults()
+{
+    database db(testPath("result_cache_rollback"));
+    CHECK(openTable(db) == 0);
+
+    CHECK(db.exec("BEGIN") == DB_OK);
+    DBDataRow row(1);
+    row.putString(0, "c", 2, "NAME");
+    CHECK(db.insert("T", row) == 3);
+    CHECK(cachedCount(db) == 3);
+    CHECK(db.exec("ROLLBACK") == DB_OK);
+    CHECK(cachedCount(db) == 2);
+
+    return 0;
+}
+
+static int evictsLeastRecentlyUsed()
+{
+    database db(testPath("result_cache_evict"));
+    CHECK(openTable(db) == 0);
+
+    std::shared_ptr<const DBDataTable> first = db.rawQueryCached("SELECT * FROM T WHERE ID = 1", NO_ARGS);
+    CHECK(first);
+    size_t entryBytes = db.getResultCacheStats().bytes;
+    CHECK(entryBytes > 0);
+
+    // room for about two entries.
+    db.setResultCacheSize(entryBytes * 2 + entryBytes / 2, false);
+    CHECK(db.rawQueryCached("SELECT * FROM T WHERE ID = 2", NO_ARGS));
+    // touching the first one makes the second the oldest.
+    CHECK(db.rawQueryCached("SELECT * FROM T WHERE ID = 1", NO_ARGS) == first);
+    CHECK(db.rawQueryCached("SELECT * FROM T WHERE ID < 2", NO_ARGS));
+
+    DBResultCacheStats stats = db.getResultCacheStats();
+    CHECK(stats.evictions == 1);
+    CHECK(stats.entries == 2);
+    CHECK(stats.bytes <= stats.budget);
+    CHECK(db.rawQueryCached("SELECT * FROM T WHERE ID = 1", NO_ARGS) == first);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(hitsUntilTableChanges);
+    RUN(clearsOnQueryWrites);
+    RUN(dropsRolledBackResults);
+    RUN(evictsLeastRecentlyUsed);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+#include "test_util.h"
+#include "database_writer.h"
+#include "database_async.h"
+
+using namespace sql;
+
+static const int64_t BIG_ROWID = 5000000000LL;
+
+static DBDataRow makeRow(int64_t id)
+{
+    DBDataRow row(2);
+    row.putLong(0, id, "ID");
+    row.putString(1, "name", 5, "NAME");
+
+    return row;
+}
+
+static int openTable(database& db)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY, NAME TEXT)") == DB_OK);
+
+    return 0;
+}
+
+static int insertReturns64BitRowid()
+{
+    database db(testPath("rowid_insert"));
+    CHECK(openTable(db) == 0);
+
+    CHECK(db.insert("T", makeRow(BIG_ROWID)) == BIG_ROWID);
+    // the next rowid sqlite picks is beyond 32 bits as well.
+    DBDataRow row(1);
+    row.putString(0, "next", 5, "NAME");
+    CHECK(db.insert("T", row) == BIG_ROWID + 1);
+    CHECK(queryLong(db, "SELECT MAX(ID) FROM T") == BIG_ROWID + 1);
+
+    return 0;
+}
+
+static int writeQueueInsertReturns64BitRowid()
+{
+    database db(testPath("rowid_write_queue"));
+    CHECK(openTable(db) == 0);
+
+    WriteQueue queue(db);
+    std::future<int64_t> rowid = queue.insert("T", makeRow(BIG_ROWID));
+    CHECK(rowid.get() == BIG_ROWID);
+
+    return 0;
+}
+
+static int asyncInsertReturns64BitRowid()
+{
+    database db(testPath("rowid_async"));
+    CHECK(openTable(db) == 0);
+
+    AsyncDatabase async(db);
+    std::future<int64_t> rowid = async.insert("T", makeRow(BIG_ROWID));
+    CHECK(rowid.get() == BIG_ROWID);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(insertReturns64BitRowid);
+    RUN(writeQueueInsertReturns64BitRowid);
+    RUN(asyncInsertReturns64BitRowid);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "test_util.h"
+#include "database_cursor.h"
+
+using namespace sql;
+
+static DBDataRow makeRow(int64_t id, const char* name)
+{
+    DBDataRow row(2);
+    row.putLong(0, id, "ID");
+    row.putString(1, name, strlen(name) + 1, "NAME");
+
+    return row;
+}
+
+static int openTable(database& db)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY, NAME TEXT)") == DB_OK);
+
+    return 0;
+}
+
+static int reusesStatements()
+{
+    database db(testPath("statement_cache_reuse"));
+    CHECK(openTable(db) == 0);
+    DBStatementCacheStats before = db.getStatementCacheStats();
+
+    CHECK(db.insert("T", makeRow(1, "a")) == 1);
+    CHECK(db.insert("T", makeRow(2, "b")) == 2);
+    CHECK(db.insert("T", makeRow(3, "c")) == 3);
+
+    DBStatementCacheStats stats = db.getStatementCacheStats();
+    CHECK(stats.misses - before.misses == 1 && stats.hits - before.hits == 2);
+    CHECK(stats.size == before.size + 1);
+
+    // bindings are cleared when a statement comes back, every value is the new one.
+    std::vector<std::string> args(1, "2");
+    std::unique_ptr<DBDataTable> first = db.rawQuery("SELECT NAME FROM T WHERE ID = ?", args);
+    args[0] = "3";
+    std::unique_ptr<DBDataTable> second = db.rawQuery("SELECT NAME FROM T WHERE ID = ?", args);
+    CHECK(first && second);
+    size_t length = 0;
+    CHECK(strcmp(first->getString(0, 0, length), "b") == 0);
+    CHECK(strcmp(second->getString(0, 0, length), "c") == 0);
+
+    CHECK(db.update("T", makeRow(2, "x"), "ID = ?", std::vector<std::string>(1, "2")) == 1);
+    CHECK(db.remove("T", "ID = ?", std::vector<std::string>(1, "3")) == 1);
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM T") == 2);
+
+    return 0;
+}
+
+static int runsSameSqlTwiceAtOnce()
+{
+    database db(testPath("statement_cache_twice"));
+    CHECK(openTable(db) == 0);
+    CHECK(db.exec("INSERT INTO T VALUES (1, 'a'), (2, 'b')") == DB_OK);
+
+    // the open cursor holds the cached statement, the query prepares a second one.
+    std::string sql("SELECT ID FROM T ORDER BY ID");
+    std::unique_ptr<Cursor> cursor = db.rawQueryCursor(sql, std::vector<std::string>());
+    CHECK(cursor && cursor->next());
+    CHECK(queryLong(db, sql) == 1);
+    CHECK(cursor->getLong(0) == 1);
+    CHECK(cursor->next() && cursor->getLong(0) == 2);
+
+    return 0;
+}
+
+static int evictsLeastRecentlyUsed()
+{
+    database db(testPath("statement_cache_evict"));
+    CHECK(openTable(db) == 0);
+    db.setStatementCacheSize(2);
+    DBStatementCacheStats before = db.getStatementCacheStats();
+
+    CHECK(queryLong(db, "SELECT 1") == 1);
+    CHECK(queryLong(db, "SELECT 2") == 2);
+    CHECK(queryLong(db, "SELECT 1") == 1);
+    CHECK(queryLong(db, "SELECT 3") == 3);
+
+    DBStatementCacheStats stats = db.getStatementCacheStats();
+    CHECK(stats.size == 2 && stats.capacity == 2);
+    CHECK(stats.evictions - before.evictions == 1);
+
+    // "SELECT 2" was the oldest.
+    CHECK(queryLong(db, "SELECT 1") == 1);
+    CHECK(queryLong(db, "SELECT 2") == 2);
+    stats = db.getStatementCacheStats();
+    CHECK(stats.hits - before.hits == 2 && stats.misses - before.misses == 4);
+
+    db.setStatementCacheSize(0);
+    CHECK(queryLong(db, "SELECT 1") == 1);
+    stats = db.getStatementCacheStats();
+    CHECK(stats.size == 0);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(reusesStatements);
+    RUN(runsSameSqlTwiceAtOnce);
+    RUN(evictsLeastRecentlyUsed);
+
+    return failures ? 1 : 0;
+}
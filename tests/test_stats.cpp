@@ -0,0 +1,67 @@
+#include "test_util.h"
+
+using namespace sql;
+
+static const std::vector<std::string> NO_ARGS;
+
+static const DBStatementStats* findStats(const std::vector<DBStatementStats>& stats, const std::string& prefix)
+{
+    for (size_t i = 0; i < stats.size(); i++) {
+        if (stats[i].sql.compare(0, prefix.size(), prefix) == 0) {
+            return &stats[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int countsRowsPerStatement()
+{
+    database db(testPath("stats_rows"));
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY)") == DB_OK);
+    CHECK(db.exec("INSERT INTO T VALUES (1), (2), (3)") == DB_OK);
+    db.setStatsEnabled(true);
+
+    CHECK(db.rawQuery("SELECT ID FROM T WHERE ID > 0", NO_ARGS));
+    CHECK(db.rawQuery("SELECT ID FROM T WHERE ID > 2", NO_ARGS));
+
+    std::vector<DBStatementStats> stats = db.stats();
+    const DBStatementStats* select = findStats(stats, "SELECT ID FROM T WHERE ID > ?");
+    CHECK(select != NULL);
+    CHECK(select->count == 2);
+    CHECK(select->rowsReturned == 4);
+
+    return 0;
+}
+
+static int leavesOutSlowQueryPlans()
+{
+    database db(testPath("stats_explain"));
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY)") == DB_OK);
+    db.setStatsEnabled(true);
+
+    int slow = 0;
+    db.setSlowQueryThreshold(0);
+    db.setSlowQueryHandler([&slow](const DBSlowQuery&) { slow++; });
+
+    CHECK(db.rawQuery("SELECT COUNT(*) FROM T", NO_ARGS));
+    CHECK(slow == 1);
+
+    std::vector<DBStatementStats> stats = db.stats();
+    CHECK(findStats(stats, "SELECT COUNT(*) FROM T") != NULL);
+    CHECK(findStats(stats, "EXPLAIN") == NULL);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(countsRowsPerStatement);
+    RUN(leavesOutSlowQueryPlans);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+#include "test_util.h"
+
+using namespace sql;
+
+static int openTable(database& db)
+{
+    CHECK(db.isOpen());
+    CHECK(db.exec("CREATE TABLE T(ID INTEGER PRIMARY KEY)") == DB_OK);
+
+    return 0;
+}
+
+static int count(database& db)
+{
+    return static_cast<int>(queryLong(db, "SELECT COUNT(*) FROM T"));
+}
+
+static int commitsOuterScope()
+{
+    database db(testPath("transaction_commit"));
+    CHECK(openTable(db) == 0);
+
+    {
+        Transaction tr(db, DBTransaction_Immediate);
+        CHECK(tr.isActive() && !tr.isNested());
+        CHECK(db.exec("INSERT INTO T VALUES (1)") == DB_OK);
+        CHECK(tr.commit() == DB_OK);
+        CHECK(!tr.isActive());
+        CHECK(tr.commit() == DB_ERROR);
+    }
+    CHECK(count(db) == 1);
+
+    // not committed, rolled back by the guard.
+    {
+        Transaction tr(db);
+        CHECK(db.exec("INSERT INTO T VALUES (2)") == DB_OK);
+    }
+    CHECK(count(db) == 1);
+
+    return 0;
+}
+
+static int nestsSavepoints()
+{
+    database db(testPath("transaction_nested"));
+    CHECK(openTable(db) == 0);
+
+    {
+        Transaction outer(db);
+        CHECK(db.exec("INSERT INTO T VALUES (1)") == DB_OK);
+        {
+            Transaction inner(db);
+            CHECK(inner.isNested());
+            CHECK(db.exec("INSERT INTO T VALUES (2)") == DB_OK);
+            {
+                Transaction innermost(db);
+                CHECK(innermost.isNested());
+                CHECK(db.exec("INSERT INTO T VALUES (3)") == DB_OK);
+                CHECK(innermost.rollback() == DB_OK);
+            }
+            CHECK(count(db) == 2);
+            CHECK(inner.commit() == DB_OK);
+        }
+        {
+            // dropped without commit, only its own rows go.
+            Transaction inner(db);
+            CHECK(db.exec("INSERT INTO T VALUES (4)") == DB_OK);
+        }
+        CHECK(count(db) == 2);
+        CHECK(outer.commit() == DB_OK);
+    }
+    CHECK(count(db) == 2);
+    CHECK(queryLong(db, "SELECT MAX(ID) FROM T") == 2);
+
+    // a committed savepoint still goes with its rolled back parent.
+    {
+        Transaction outer(db);
+        {
+            Transaction inner(db);
+            CHECK(db.exec("INSERT INTO T VALUES (5)") == DB_OK);
+            CHECK(inner.commit() == DB_OK);
+        }
+        CHECK(outer.rollback() == DB_OK);
+    }
+    CHECK(count(db) == 2);
+
+    return 0;
+}
+
+static int nestsInsideExecTransaction()
+{
+    database db(testPath("transaction_exec"));
+    CHECK(openTable(db) == 0);
+
+    CHECK(db.exec("BEGIN") == DB_OK);
+    CHECK(db.exec("INSERT INTO T VALUES (1)") == DB_OK);
+    {
+        Transaction tr(db);
+        CHECK(tr.isNested());
+        CHECK(db.exec("INSERT INTO T VALUES (2)") == DB_OK);
+    }
+    CHECK(db.exec("COMMIT") == DB_OK);
+    CHECK(count(db) == 1);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(commitsOuterScope);
+    RUN(nestsSavepoints);
+    RUN(nestsInsideExecTransaction);
+
+    return failures ? 1 : 0;
+}
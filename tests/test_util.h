@@ -0,0 +1,50 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#ifndef __cplusplus
+#    error ERROR: This file requires C++ compilation (use a .cpp suffix)
+#endif
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "database.h"
+
+/*fails the running test function with the location of the check*/
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr);          \
+            return 1;                                                       \
+        }                                                                   \
+    } while (0)
+
+#define RUN(test)                                                           \
+    do {                                                                    \
+        int failed = test();                                                \
+        printf("%s %s\n", failed ? "FAIL" : "ok  ", #test);                 \
+        failures += failed;                                                 \
+    } while (0)
+
+/*a fresh database file in the working directory*/
+inline std::string testPath(const char* name)
+{
+    std::string path = std::string(name) + ".db";
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+    remove((path + "-journal").c_str());
+
+    return path;
+}
+
+inline int64_t queryLong(sql::database& db, const std::string& sql)
+{
+    std::unique_ptr<sql::DBDataTable> result = db.rawQuery(sql, std::vector<std::string>());
+
+    return result ? result->getLong(0, 0) : -1;
+}
+
+#endif /* TEST_UTIL_H */
+/* EOF */
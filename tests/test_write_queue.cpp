@@ -0,0 +1,56 @@
+#include <stdexcept>
+
+#include "test_util.h"
+#include "database_writer.h"
+
+using namespace sql;
+
+static int insertValue(database& db, int value)
+{
+    return db.exec("INSERT INTO T VALUES (" + std::to_string(value) + ")") == DB_OK ? 0 : -1;
+}
+
+static int throwingOperationKeepsBatch()
+{
+    database db(testPath("write_queue_throw"));
+    CHECK(db.exec("CREATE TABLE T(V INTEGER)") == DB_OK);
+
+    // a long latency puts all three operations into one flush.
+    WriteQueue queue(db, 16, 200);
+    std::future<int64_t> before = queue.enqueue([](database& db) { return insertValue(db, 1); });
+    std::future<int64_t> failing = queue.enqueue([](database& db) -> int {
+        insertValue(db, 2);
+        throw std::runtime_error("operation failed");
+    });
+    std::future<int64_t> after = queue.enqueue([](database& db) { return insertValue(db, 3); });
+
+    CHECK(before.get() == 0);
+    CHECK(after.get() == 0);
+
+    bool thrown = false;
+    try {
+        failing.get();
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    queue.stop();
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM T") == 2);
+    CHECK(queryLong(db, "SELECT COUNT(*) FROM T WHERE V=2") == 0);
+
+    DBWriteQueueStats stats = queue.getStats();
+    CHECK(stats.operations == 3 && stats.failedCommits == 0);
+
+    return 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    RUN(throwingOperationKeepsBatch);
+
+    return failures ? 1 : 0;
+}